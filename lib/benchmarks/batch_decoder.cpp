@@ -0,0 +1,83 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the BatchDecoder kernels, compared to decoding the packets one by one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "BatchDecoder.h"
+
+#define ITERATIONS 200000
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+  static unsigned char packets[PHANTOM_BATCH_SIZE][PhantomPacketLayout::READ_SIZE];
+  static const unsigned char *pointers[PHANTOM_BATCH_SIZE];
+  static PhantomStateBatch batch;
+  static PhantomState states[PHANTOM_BATCH_SIZE];
+  unsigned int sum = 0;
+
+  for (unsigned int i = 0; i < PHANTOM_BATCH_SIZE; i++)
+  {
+    for (unsigned int j = 0; j < PhantomPacketLayout::READ_SIZE; j++)
+    {
+      packets[i][j] = rand();
+    }
+    pointers[i] = packets[i];
+  }
+
+  double start = now();
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    for (int j = 0; j < PHANTOM_BATCH_SIZE; j++)
+    {
+      decodePhantomState(pointers[j], states[j]);
+    }
+    sum += states[i % PHANTOM_BATCH_SIZE].count0;
+  }
+  printf("%-24s %5.2f ns per packet\n", "decodePhantomState", (now() - start) * 1e9 / ITERATIONS / PHANTOM_BATCH_SIZE);
+
+  for (int k = BatchDecoder::SCALAR; k <= BatchDecoder::AVX2; k++)
+  {
+    if (!BatchDecoder::setKernel((BatchDecoder::Kernel) k))
+      continue;
+
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+      BatchDecoder::decode(pointers, PHANTOM_BATCH_SIZE, batch);
+      sum += batch.count0[i % PHANTOM_BATCH_SIZE];
+    }
+    printf("BatchDecoder %-11s %5.2f ns per packet\n", BatchDecoder::getKernelName((BatchDecoder::Kernel) k), (now()
+        - start) * 1e9 / ITERATIONS / PHANTOM_BATCH_SIZE);
+  }
+  printf("(%u)\n", sum % 2);
+  return 0;
+}
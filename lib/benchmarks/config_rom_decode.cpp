@@ -0,0 +1,82 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the config ROM decoder: cost of byte swapping and decoding an image which is already read
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+
+#include "ConfigRom.h"
+#include "config_rom_corpus.h"
+
+#define ITERATIONS 1000000
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void benchmark(const char *name, const u_int32_t *image, unsigned int length)
+{
+  u_int32_t wire[CONFIG_ROM_QUADLETS], buffer[CONFIG_ROM_QUADLETS];
+  struct config_rom crom;
+  unsigned int i, needed = 0;
+  double start;
+
+  // Create the image as it is received from the bus (big endian)
+  for (i = 0; i < length; i++)
+  {
+    wire[i] = htonl(image[i]);
+  }
+
+  start = now();
+  for (i = 0; i < ITERATIONS; i++)
+  {
+    memcpy(buffer, wire, length * 4);
+    configRomToHostOrder(buffer, length);
+    needed += buffer[i % length] & 1;
+  }
+  double swap = (now() - start) * 1e9 / ITERATIONS;
+
+  start = now();
+  for (i = 0; i < ITERATIONS; i++)
+  {
+    needed += decodeConfigRom(image, length, &crom);
+  }
+  double decode = (now() - start) * 1e9 / ITERATIONS;
+
+  printf("%-20s %3u quadlets: copy+swap %7.1f ns, decode (incl. CRCs) %7.1f ns (%u)\n", name, length, swap, decode,
+      needed % 2);
+}
+
+int main()
+{
+  using namespace ConfigRomCorpus;
+
+  benchmark("PHANTOM Omni", rom_omni, sizeof(rom_omni) / 4);
+  benchmark("host controller", rom_ohci, sizeof(rom_ohci) / 4);
+  benchmark("many entries", rom_many_entries, sizeof(rom_many_entries) / 4);
+  return 0;
+}
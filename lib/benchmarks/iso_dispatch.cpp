@@ -0,0 +1,147 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the per packet dispatch of isochronous data to the application: a runtime registered callback, a
+ * callback forwarding to a virtual interface and a handler set with setHandler(), for which the dispatch is resolved at
+ * compile time
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "PhantomIsoChannel.h"
+#include "fake_device.h"
+
+#define ITERATIONS 100000000
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Application code: keeps track of the position
+ */
+struct Tracker
+{
+  unsigned int sum;
+
+  void received(const PhantomDataRead &data)
+  {
+    sum += data.encoder_x;
+  }
+
+  void transmit(PhantomDataWrite &)
+  {
+  }
+};
+
+static void trackerReceived(const PhantomDataRead *data, void *userdata)
+{
+  ((Tracker *) userdata)->received(*data);
+}
+
+class VirtualHandler
+{
+public:
+  virtual ~VirtualHandler()
+  {
+  }
+  virtual void received(const PhantomDataRead &data) = 0;
+};
+
+class VirtualTracker : public VirtualHandler
+{
+public:
+  unsigned int sum;
+
+  void received(const PhantomDataRead &data)
+  {
+    sum += data.encoder_x;
+  }
+};
+
+static void virtualReceived(const PhantomDataRead *data, void *userdata)
+{
+  ((VirtualHandler *) userdata)->received(*data);
+}
+
+static void run(const char *name, FakeDevice &device, PhantomIsoChannel &channel)
+{
+  unsigned char packet[64];
+
+  memset(packet, 0, sizeof(packet));
+  channel.start();
+
+  double start = now();
+  for (unsigned int i = 0; i < ITERATIONS; i++)
+  {
+    ((PhantomDataRead *) packet)->encoder_x = i;
+    device.iso->callbackRecvHandler(packet, 48);
+  }
+  double ns = (now() - start) * 1e9 / ITERATIONS;
+  printf("%-20s %5.2f ns per packet\n", name, ns);
+}
+
+static void benchmark(const char *name, PhantomReceiveCallback callback, void *userdata)
+{
+  FakeDevice device;
+  device.iso = 0;
+  PhantomIsoChannel channel(&device, true);
+
+  channel.setCallbacks(callback, 0, userdata);
+  run(name, device, channel);
+}
+
+template<class Handler>
+static void benchmark(const char *name, Handler *handler)
+{
+  FakeDevice device;
+  device.iso = 0;
+  PhantomIsoChannel channel(&device, true);
+
+  channel.setHandler(handler);
+  run(name, device, channel);
+}
+
+int main()
+{
+  try
+  {
+    Tracker tracker;
+    VirtualTracker virtualTracker;
+    tracker.sum = virtualTracker.sum = 0;
+
+    benchmark("no callback", 0, 0);
+    benchmark("runtime callback", trackerReceived, &tracker);
+    benchmark("virtual handler", virtualReceived, (VirtualHandler *) &virtualTracker);
+    benchmark("template handler", &tracker);
+    printf("(%u)\n", (tracker.sum + virtualTracker.sum) % 2);
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of decoding received packets into a PhantomState: shift/mask decoder versus the bitfields of PhantomSpec.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "PhantomPacket.h"
+
+#define PACKETS 1024
+#define ITERATIONS 20000
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void decodeBitfields(const PhantomDataRead *raw, PhantomState &state)
+{
+  state.encoder[0] = raw->encoder_x;
+  state.encoder[1] = raw->encoder_y;
+  state.encoder[2] = raw->encoder_z;
+  state.gimbal[0] = raw->gimbal.x;
+  state.gimbal[1] = raw->gimbal.y;
+  state.gimbal[2] = raw->gimbal.z;
+  state.count0 = raw->count0;
+  state.count1 = raw->count1;
+  state.button1 = !raw->status.button1;
+  state.button2 = !raw->status.button2;
+  state.docked = !raw->status.docked;
+}
+
+int main()
+{
+  static PhantomDataRead packets[PACKETS];
+  static PhantomState states[PACKETS];
+  unsigned int sum = 0;
+
+  for (unsigned int i = 0; i < sizeof(packets); i++)
+  {
+    ((unsigned char *) packets)[i] = rand();
+  }
+
+  double start = now();
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    for (int j = 0; j < PACKETS; j++)
+    {
+      decodePhantomState((const unsigned char *) &packets[j], states[j]);
+    }
+    sum += states[i % PACKETS].gimbal[0];
+  }
+  double shift = (now() - start) * 1e9 / ITERATIONS / PACKETS;
+
+  start = now();
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    for (int j = 0; j < PACKETS; j++)
+    {
+      decodeBitfields(&packets[j], states[j]);
+    }
+    sum += states[i % PACKETS].gimbal[0];
+  }
+  double bitfields = (now() - start) * 1e9 / ITERATIONS / PACKETS;
+
+  printf("shift/mask decoder %5.2f ns per packet\n", shift);
+  printf("bitfields          %5.2f ns per packet (%u)\n", bitfields, sum % 2);
+  return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the receive latency (from the packet becoming available until the application callback) when the
+ * iterating thread waits for the packets (interrupt mode) or busy polls for them. A thread stands in for the kernel:
+ * it writes a packet with a timestamp into a pipe every millisecond.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "PhantomIsoChannel.h"
+#include "ServoThread.h"
+#include "fake_device.h"
+
+#define PACKETS 2000
+#define PERIOD  1000000 // nanoseconds
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double latencies[PACKETS];
+static std::atomic<unsigned int> received;
+
+static void latencyReceived(const PhantomDataRead *data, void *userdata)
+{
+  double sent;
+  memcpy(&sent, (const unsigned char *) data + 24, sizeof(sent));
+  unsigned int i = received.load(std::memory_order_relaxed);
+  if (i < PACKETS)
+  {
+    latencies[i] = now() - sent;
+  }
+  received.store(i + 1, std::memory_order_relaxed);
+}
+
+static void produce(int fd, int cpu)
+{
+  unsigned char packet[FakeCommunication::PACKET_SIZE];
+  struct timespec next;
+
+  ServoThread::setRealtime(90);
+  ServoThread::pinToCpu(cpu);
+  memset(packet, 0, sizeof(packet));
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (unsigned int i = 0; i < PACKETS; i++)
+  {
+    next.tv_nsec += PERIOD;
+    if (next.tv_nsec >= 1000000000)
+    {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+
+    double sent = now();
+    memcpy(packet + 24, &sent, sizeof(sent));
+    if (write(fd, packet, sizeof(packet)) != sizeof(packet))
+    {
+      break;
+    }
+  }
+}
+
+static void benchmark(const char *name, bool busyPoll, int cpu, int producerCpu)
+{
+  FakeDevice device;
+  device.iso = 0;
+  PhantomIsoChannel channel(&device, true);
+  int fds[2];
+
+  if (pipe(fds) != 0)
+  {
+    throw "Could not create a pipe";
+  }
+  device.iso->fd = fds[0];
+  channel.setCallbacks(latencyReceived, 0, 0);
+  channel.start();
+  received.store(0);
+
+  std::thread producer(produce, fds[1], producerCpu);
+  std::thread consumer([&]()
+  {
+    ServoThread::setRealtime(80);
+    ServoThread::pinToCpu(cpu);
+    ServoThread::prefaultStack();
+    while (received.load(std::memory_order_relaxed) < PACKETS)
+    {
+      if (!busyPoll)
+      {
+        channel.iterate();
+      }
+      else if (!channel.pollIterate())
+      {
+        ServoThread::relax();
+      }
+    }
+  });
+  producer.join();
+  consumer.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  std::sort(latencies, latencies + PACKETS);
+  double sum = 0;
+  for (unsigned int i = 0; i < PACKETS; i++)
+  {
+    sum += latencies[i];
+  }
+  printf("%-12s mean %7.2f us, median %7.2f us, 99%% %7.2f us, max %8.2f us\n", name, sum / PACKETS * 1e6,
+      latencies[PACKETS / 2] * 1e6, latencies[PACKETS * 99 / 100] * 1e6, latencies[PACKETS - 1] * 1e6);
+}
+
+int main()
+{
+  try
+  {
+    // Run the consumer on the last CPU and the producer on another one (if there is one)
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int cpu = cpus - 1, producerCpu = cpus > 1 ? cpus - 2 : 0;
+    if (cpus == 1)
+    {
+      printf("Only one CPU: the busy polling thread competes with the packet producer\n");
+    }
+
+    benchmark("interrupt", false, cpu, producerCpu);
+    benchmark("busy poll", true, cpu, producerCpu);
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the StateBuffer with one writer (the isochronous thread) and 8 reader threads, all as fast as possible
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+
+#include "PhantomPacket.h"
+#include "StateBuffer.h"
+
+#define READERS 8
+#define DURATION 1.0
+
+using namespace LibPhantom;
+
+static StateBuffer<PhantomState> state;
+static std::atomic<bool> running(true);
+
+struct ReaderResult
+{
+  unsigned long long reads;
+  unsigned long long torn;
+  double seconds;
+};
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void reader(ReaderResult *result)
+{
+  PhantomState data;
+  double start = now();
+
+  result->reads = result->torn = 0;
+  while (running.load(std::memory_order_relaxed))
+  {
+    if (state.read(data))
+    {
+      // The writer puts the same value in all fields, a mix of values means the copy is not consistent
+      if (data.encoder[0] != (uint16_t) data.count0 || data.encoder[2] != (uint16_t) data.count0)
+        result->torn++;
+    }
+    result->reads++;
+  }
+  result->seconds = now() - start;
+}
+
+int main()
+{
+  PhantomState data = PhantomState();
+  ReaderResult results[READERS];
+  std::thread *threads[READERS];
+  unsigned long long writes = 0;
+
+  for (int i = 0; i < READERS; i++)
+  {
+    threads[i] = new std::thread(reader, &results[i]);
+  }
+
+  double start = now();
+  double end = start + DURATION;
+  while (now() < end)
+  {
+    for (int i = 0; i < 1000; i++, writes++)
+    {
+      data.count0 = writes;
+      data.encoder[0] = data.encoder[1] = data.encoder[2] = writes;
+      state.write(data);
+    }
+  }
+  double seconds = now() - start;
+  running = false;
+
+  unsigned long long reads = 0, torn = 0;
+  for (int i = 0; i < READERS; i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+    printf("reader %d: %7.1f ns per read\n", i, results[i].seconds * 1e9 / results[i].reads);
+    reads += results[i].reads;
+    torn += results[i].torn;
+  }
+  printf("writer:   %7.1f ns per write (%llu writes)\n", seconds * 1e9 / writes, writes);
+  printf("%llu reads, %llu inconsistent\n", reads, torn);
+  return torn != 0;
+}
@@ -21,10 +21,26 @@ define CreateTestAppTargets
   $(foreach test_app,$(1),
     # Create link target
     build_dir/$(test_app): tests/$(test_app).cpp bin/libphantom.a
-	$(CXX) $(CFLAGS) $(CPPFLAGS) -Lbin -Isrc -o $$@ $$< $(LIBS) -lphantom
+	$(CXX) $(CFLAGS) $(CFLAGS_$(test_app)) $(CPPFLAGS) -Lbin -Isrc -o $$@ $$< $(LIBS) -lphantom
   )
 endef
 
+define CreateBenchAppTargets
+  $(foreach bench_app,$(1),
+    # Create link target
+    build_dir/benchmarks/$(bench_app): benchmarks/$(bench_app).cpp bin/libphantom.a | build_dir/benchmarks
+	$(CXX) $(CFLAGS) $(CPPFLAGS) -Lbin -Isrc -Itests -o $$@ $$< $(LIBS) -lphantom
+  )
+endef
+
+define RunBenchmarks
+$(foreach bench_app,$(1),
+	@echo
+	@echo Running benchmark: $(bench_app)
+	@-build_dir/benchmarks/$(bench_app)
+)
+endef
+
 define RunTests
 $(foreach test_app,$(1),
 	@echo
@@ -34,6 +50,6 @@ $(foreach test_app,$(1),
 endef
 
 # Add targets for the required directories
-build_dir bin:
+build_dir bin build_dir/benchmarks:
 	@mkdir -p $@
 
@@ -0,0 +1,100 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: simple arena (bump) allocator
+ */
+
+#include <stdlib.h>
+
+#include "Arena.h"
+
+#define ALIGNMENT    16
+#define ALIGN(size)  (((size) + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1))
+
+// Room for the Block header at the start of each block (keeps the allocations aligned)
+#define HEADER_SIZE  ALIGN(sizeof(Block))
+
+using namespace LibPhantom;
+
+std::atomic<Arena::Block *> Arena::spare(0);
+
+Arena::Arena(size_t blockSize) :
+  blockSize(HEADER_SIZE + ALIGN(blockSize)), blocks(0), used(0)
+{
+}
+
+Arena::~Arena()
+{
+  reset();
+
+  // Keep the block for the next arena, replacing the previous spare block
+  free(spare.exchange(blocks));
+}
+
+void *Arena::allocate(size_t size)
+{
+  size = ALIGN(size);
+  if (size > blockSize - HEADER_SIZE)
+  {
+    // TODO Create some library exception and throw that one
+    throw "Arena allocation is larger than the block size";
+  }
+
+  if (blocks == 0 || used + size > blockSize)
+  {
+    Block *block = 0;
+    if (blocks == 0)
+    {
+      block = spare.exchange(0);
+      if (block != 0 && block->size < blockSize)
+      {
+        free(block);
+        block = 0;
+      }
+    }
+    if (block == 0)
+    {
+      block = (Block *) malloc(blockSize);
+      if (block == 0)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Out of memory";
+      }
+      block->size = blockSize;
+    }
+    block->next = blocks;
+    blocks = block;
+    used = HEADER_SIZE;
+  }
+
+  void *ptr = (char *) blocks + used;
+  used += size;
+  return ptr;
+}
+
+void Arena::reset()
+{
+  // Only keep the oldest block, which is the last one in the list
+  while (blocks != 0 && blocks->next != 0)
+  {
+    Block *next = blocks->next;
+    free(blocks);
+    blocks = next;
+  }
+  used = HEADER_SIZE;
+}
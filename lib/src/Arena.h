@@ -0,0 +1,81 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: simple arena (bump) allocator
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+namespace LibPhantom
+{
+  /**
+   * Hands out memory from large blocks, which is released all at once when the arena is reset or destroyed.
+   *
+   * The first block of an arena is recycled: it is kept when the arena is destroyed and reused by the next arena, so
+   * creating an arena over and over (ie for every bus scan) does not allocate memory once the program runs.
+   */
+  class Arena
+  {
+  public:
+    /**
+     * @param blockSize size of the blocks in bytes; allocations larger than this are not possible
+     */
+    Arena(size_t blockSize);
+    ~Arena();
+
+    /**
+     * @return size bytes of memory (aligned to 16 bytes) which stays valid until reset() is called or the arena is
+     *         destroyed
+     * @throws some exception if size is larger than the block size or no memory is available
+     */
+    void *allocate(size_t size);
+
+    /**
+     * Releases all allocated memory at once. Only the oldest block is kept for new allocations, the blocks that were
+     * added when it got full are freed (so the arena shrinks back to a single block).
+     */
+    void reset();
+
+  protected:
+    struct Block
+    {
+      Block *next;
+      size_t size;
+    };
+
+    size_t blockSize;
+
+    /**
+     * Allocated blocks, the first block is the current one
+     */
+    Block *blocks;
+
+    /**
+     * Number of bytes in use in the current block (including the Block header)
+     */
+    size_t used;
+
+    /**
+     * Recycled block of the last arena that was destroyed
+     */
+    static std::atomic<Block *> spare;
+  };
+}
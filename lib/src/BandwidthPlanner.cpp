@@ -0,0 +1,191 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: plans the isochronous bandwidth of multiple Phantom devices before starting them
+ */
+
+#include "BandwidthPlanner.h"
+
+using namespace LibPhantom;
+
+BandwidthPlanner::BandwidthPlanner(Policy policy, bool downgrade) :
+  policy(policy), downgrade(downgrade)
+{
+}
+
+void BandwidthPlanner::add(Phantom *phantom, Phantom::StartMode mode)
+{
+  DevicePlan device;
+  device.phantom = phantom;
+  device.requested = mode;
+  device.mode = mode;
+  device.port = phantom->getFirewireDevice()->getPort();
+  device.requestedUnits = phantom->getRequiredBandwidth(mode);
+  device.minimumUnits = mode == Phantom::FULL ? phantom->getRequiredBandwidth(Phantom::RECEIVE_ONLY)
+      : device.requestedUnits;
+  device.units = device.requestedUnits;
+  device.accepted = false;
+  devices.push_back(device);
+}
+
+void BandwidthPlanner::add(const PhantomList &phantoms, Phantom::StartMode mode)
+{
+  for (PhantomList::const_iterator it = phantoms.begin(); it != phantoms.end(); it++)
+  {
+    add(*it, mode);
+  }
+}
+
+bool BandwidthPlanner::plan()
+{
+  bool all = true;
+  ports.clear();
+
+  for (std::vector<DevicePlan>::iterator device = devices.begin(); device != devices.end(); device++)
+  {
+    PortPlan *port = findPort(device->port);
+    if (!port)
+    {
+      // First device of this port, so the bandwidth of the port is read only once
+      PortPlan p;
+      p.port = device->port;
+      p.available = device->phantom->getFirewireDevice()->getAvailableBandwidth();
+      p.planned = 0;
+      p.headroom = p.available;
+      p.rejected = 0;
+      p.downgraded = 0;
+      ports.push_back(p);
+      port = &ports.back();
+    }
+
+    // When downgrading, every device first gets the bandwidth to receive only, so as many devices as possible fit
+    device->mode = downgrade ? Phantom::RECEIVE_ONLY : device->requested;
+    device->units = downgrade ? device->minimumUnits : device->requestedUnits;
+    device->accepted = device->units <= port->headroom;
+    if (device->accepted)
+    {
+      port->planned += device->units;
+      port->headroom -= device->units;
+    }
+    else
+    {
+      device->mode = device->requested;
+      device->units = device->requestedUnits;
+      port->rejected++;
+      all = false;
+    }
+  }
+
+  if (downgrade)
+  {
+    // Let the accepted devices transmit as well (in the order they were added) while the bandwidth allows
+    for (std::vector<DevicePlan>::iterator device = devices.begin(); device != devices.end(); device++)
+    {
+      if (!device->accepted)
+      {
+        continue;
+      }
+      PortPlan *port = findPort(device->port);
+      unsigned int extra = device->requestedUnits - device->units;
+      if (extra <= port->headroom)
+      {
+        device->mode = device->requested;
+        device->units = device->requestedUnits;
+        port->planned += extra;
+        port->headroom -= extra;
+      }
+      else
+      {
+        port->downgraded++;
+        all = false;
+      }
+    }
+  }
+
+  if (policy == ALL_OR_NOTHING)
+  {
+    // Reject the remaining devices of the ports on which not everything fits
+    for (std::vector<PortPlan>::iterator port = ports.begin(); port != ports.end(); port++)
+    {
+      if (port->rejected == 0)
+      {
+        continue;
+      }
+      for (std::vector<DevicePlan>::iterator device = devices.begin(); device != devices.end(); device++)
+      {
+        if (device->port == port->port && device->accepted)
+        {
+          device->mode = device->requested;
+          device->units = device->requestedUnits;
+          device->accepted = false;
+          port->rejected++;
+        }
+      }
+      port->planned = 0;
+      port->headroom = port->available;
+      port->downgraded = 0;
+    }
+  }
+
+  return all;
+}
+
+bool BandwidthPlanner::isAccepted(Phantom *phantom)
+{
+  for (std::vector<DevicePlan>::iterator device = devices.begin(); device != devices.end(); device++)
+  {
+    if (device->phantom == phantom)
+    {
+      return device->accepted;
+    }
+  }
+  return false;
+}
+
+void BandwidthPlanner::startAccepted()
+{
+  for (std::vector<DevicePlan>::iterator device = devices.begin(); device != devices.end(); device++)
+  {
+    if (device->accepted)
+    {
+      device->phantom->startPhantom(device->mode);
+    }
+  }
+}
+
+BandwidthPlanner::PortPlan *BandwidthPlanner::findPort(u_int32_t port)
+{
+  for (std::vector<PortPlan>::iterator it = ports.begin(); it != ports.end(); it++)
+  {
+    if (it->port == port)
+    {
+      return &*it;
+    }
+  }
+  return 0;
+}
+
+const std::vector<BandwidthPlanner::DevicePlan>& BandwidthPlanner::getDevices()
+{
+  return devices;
+}
+
+const std::vector<BandwidthPlanner::PortPlan>& BandwidthPlanner::getPorts()
+{
+  return ports;
+}
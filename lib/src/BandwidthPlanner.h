@@ -0,0 +1,163 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: plans the isochronous bandwidth of multiple Phantom devices before starting them
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <vector>
+#include "Phantom.h"
+
+namespace LibPhantom
+{
+  /**
+   * Checks whether a set of Phantom devices fits in the isochronous bandwidth which is still available on their
+   * port(s), so a configuration can be rejected (or downgraded) before any device is started instead of failing halfway.
+   * When downgrading is enabled, devices added with FULL are planned with RECEIVE_ONLY when there is not enough
+   * bandwidth to transmit to them as well.
+   *
+   * The planner does not reserve anything: other nodes can still allocate bandwidth between plan() and starting the
+   * devices, in which case startPhantom() fails as before.
+   */
+  class BandwidthPlanner
+  {
+  public:
+    enum Policy
+    {
+      /**
+       * When not all devices of a port fit, none of the devices of that port are accepted
+       */
+      ALL_OR_NOTHING,
+
+      /**
+       * Devices are accepted in the order they were added, devices which do not fit anymore are left out
+       */
+      BEST_EFFORT
+    };
+
+    /**
+     * Planned bandwidth of a single device
+     */
+    struct DevicePlan
+    {
+      Phantom *phantom;
+
+      /**
+       * Mode the device was added with, and the mode it is planned with (RECEIVE_ONLY when it is downgraded)
+       */
+      Phantom::StartMode requested;
+      Phantom::StartMode mode;
+      u_int32_t port;
+
+      /**
+       * Bandwidth of the planned mode
+       */
+      unsigned int units;
+
+      /**
+       * Bandwidth of the requested mode and of RECEIVE_ONLY
+       */
+      unsigned int requestedUnits;
+      unsigned int minimumUnits;
+      bool accepted;
+    };
+
+    /**
+     * Planned bandwidth of a single port
+     */
+    struct PortPlan
+    {
+      u_int32_t port;
+
+      /**
+       * Bandwidth available at the isochronous resource manager while planning
+       */
+      unsigned int available;
+
+      /**
+       * Bandwidth required by the accepted devices
+       */
+      unsigned int planned;
+
+      /**
+       * Bandwidth which is left when the accepted devices are started (available - planned)
+       */
+      unsigned int headroom;
+
+      /**
+       * Number of devices which did not fit
+       */
+      unsigned int rejected;
+
+      /**
+       * Number of accepted devices which are planned with RECEIVE_ONLY instead of FULL
+       */
+      unsigned int downgraded;
+    };
+
+    /**
+     * @param downgrade when true, a device added with FULL is accepted with RECEIVE_ONLY when it only fits without
+     *        transmitting. As many devices as possible are accepted first (in the order they were added), the remaining
+     *        bandwidth is used to let the first of them transmit.
+     */
+    BandwidthPlanner(Policy policy = ALL_OR_NOTHING, bool downgrade = false);
+
+    /**
+     * Adds a (not yet started) device to the plan, the devices added first get priority with the BEST_EFFORT policy
+     */
+    void add(Phantom *phantom, Phantom::StartMode mode = Phantom::FULL);
+    void add(const PhantomList &phantoms, Phantom::StartMode mode = Phantom::FULL);
+
+    /**
+     * Reads the available bandwidth of the ports and determines which devices can be started
+     *
+     * @return true if all devices are accepted in the mode they were added with
+     */
+    bool plan();
+
+    /**
+     * @return true if the device is accepted by the last plan()
+     */
+    bool isAccepted(Phantom *phantom);
+
+    /**
+     * Starts all accepted devices, in the mode they are planned with
+     */
+    void startAccepted();
+
+    const std::vector<DevicePlan>& getDevices();
+
+    /**
+     * @return the headroom per port, as determined by the last plan()
+     */
+    const std::vector<PortPlan>& getPorts();
+
+  protected:
+    Policy policy;
+    bool downgrade;
+    std::vector<DevicePlan> devices;
+    std::vector<PortPlan> ports;
+
+    /**
+     * @return the plan of the port, or 0 when none of the devices is on that port
+     */
+    PortPlan *findPort(u_int32_t port);
+  };
+}
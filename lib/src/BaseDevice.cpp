@@ -33,3 +33,8 @@ BaseDevice::~BaseDevice()
   delete firewireDevice;
 }
 
+FirewireDevice *BaseDevice::getFirewireDevice()
+{
+  return firewireDevice;
+}
+
@@ -41,6 +41,11 @@ namespace LibPhantom
      */
     virtual u_int32_t readDeviceSerial() = 0;
 
+    /**
+     * @return the firewire device used to communicate with the device (owned by this device)
+     */
+    FirewireDevice *getFirewireDevice();
+
   protected:
     /**
      * Communication handle for device
@@ -0,0 +1,283 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: decoding a batch of received packets at once (using SIMD instructions when available)
+ */
+
+#include "BatchDecoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_DECODER_X86
+#include <immintrin.h>
+#endif
+
+using namespace LibPhantom;
+using namespace PhantomPacketLayout;
+
+void PhantomStateBatch::get(unsigned int index, PhantomState &state) const
+{
+  for (unsigned int axis = 0; axis < 3; axis++)
+  {
+    state.encoder[axis] = encoder[axis][index];
+    state.gimbal[axis] = gimbal[axis][index];
+  }
+  state.count0 = count0[index];
+  state.count1 = count1[index];
+  state.button1 = button1[index];
+  state.button2 = button2[index];
+  state.docked = docked[index];
+}
+
+static void decodeScalar(const unsigned char * const *packets, unsigned int start, unsigned int end,
+    PhantomStateBatch &batch)
+{
+  for (unsigned int i = start; i < end; i++)
+  {
+    const unsigned char *p = packets[i];
+    batch.encoder[0][i] = readField(p, ENCODER_X);
+    batch.encoder[1][i] = readField(p, ENCODER_Y);
+    batch.encoder[2][i] = readField(p, ENCODER_Z);
+    batch.gimbal[0][i] = readField(p, GIMBAL_X);
+    batch.gimbal[1][i] = readField(p, GIMBAL_Y);
+    batch.gimbal[2][i] = readField(p, GIMBAL_Z);
+    batch.count0[i] = readField(p, COUNT0);
+    batch.count1[i] = readField(p, COUNT1);
+    batch.button1[i] = readField(p, BUTTON1) ^ 1;
+    batch.button2[i] = readField(p, BUTTON2) ^ 1;
+    batch.docked[i] = readField(p, DOCKED) ^ 1;
+  }
+}
+
+#ifdef BATCH_DECODER_X86
+
+/*
+ * The SIMD kernels load the same 16 bytes (8 little endian words) of 8 packets and transpose them, so each vector
+ * contains one word of all packets. Two ranges are transposed:
+ *   offset 4:  encoder x/y/z, gimbal x/y/z, unknown8, status (in the high byte)
+ *   offset 28: unknown14/15, count0 (low/high word), unknown18/19, count1, unknown21
+ * The AVX2 kernel does the same for 16 packets: packet i in the low lane and packet i + 8 in the high lane.
+ */
+#define WORDS_OFFSET    4
+#define COUNTS_OFFSET   28
+
+static_assert(ENCODER_X.offset == WORDS_OFFSET && GIMBAL_Z.offset == WORDS_OFFSET + 10 && BUTTON1.offset
+    == WORDS_OFFSET + 14, "Layout does not match the SIMD kernels");
+static_assert(COUNT0.offset == COUNTS_OFFSET + 4 && COUNT1.offset == COUNTS_OFFSET + 12 && COUNTS_OFFSET + 16
+    <= READ_SIZE, "Layout does not match the SIMD kernels");
+
+#define TRANSPOSE_8X16(suffix, type, r) \
+  { \
+    type t0 = _mm##suffix##_unpacklo_epi16(r[0], r[1]), t1 = _mm##suffix##_unpackhi_epi16(r[0], r[1]); \
+    type t2 = _mm##suffix##_unpacklo_epi16(r[2], r[3]), t3 = _mm##suffix##_unpackhi_epi16(r[2], r[3]); \
+    type t4 = _mm##suffix##_unpacklo_epi16(r[4], r[5]), t5 = _mm##suffix##_unpackhi_epi16(r[4], r[5]); \
+    type t6 = _mm##suffix##_unpacklo_epi16(r[6], r[7]), t7 = _mm##suffix##_unpackhi_epi16(r[6], r[7]); \
+    type u0 = _mm##suffix##_unpacklo_epi32(t0, t2), u1 = _mm##suffix##_unpackhi_epi32(t0, t2); \
+    type u2 = _mm##suffix##_unpacklo_epi32(t1, t3), u3 = _mm##suffix##_unpackhi_epi32(t1, t3); \
+    type u4 = _mm##suffix##_unpacklo_epi32(t4, t6), u5 = _mm##suffix##_unpackhi_epi32(t4, t6); \
+    type u6 = _mm##suffix##_unpacklo_epi32(t5, t7), u7 = _mm##suffix##_unpackhi_epi32(t5, t7); \
+    r[0] = _mm##suffix##_unpacklo_epi64(u0, u4); r[1] = _mm##suffix##_unpackhi_epi64(u0, u4); \
+    r[2] = _mm##suffix##_unpacklo_epi64(u1, u5); r[3] = _mm##suffix##_unpackhi_epi64(u1, u5); \
+    r[4] = _mm##suffix##_unpacklo_epi64(u2, u6); r[5] = _mm##suffix##_unpackhi_epi64(u2, u6); \
+    r[6] = _mm##suffix##_unpacklo_epi64(u3, u7); r[7] = _mm##suffix##_unpackhi_epi64(u3, u7); \
+  }
+
+__attribute__ ((target ("sse2")))
+static void decodeSse2(const unsigned char * const *packets, unsigned int i, PhantomStateBatch &batch)
+{
+  __m128i r[8], one = _mm_set1_epi16(1);
+
+  for (unsigned int j = 0; j < 8; j++)
+  {
+    r[j] = _mm_loadu_si128((const __m128i *) (packets[i + j] + WORDS_OFFSET));
+  }
+  TRANSPOSE_8X16(, __m128i, r);
+
+  _mm_storeu_si128((__m128i *) &batch.encoder[0][i], r[0]);
+  _mm_storeu_si128((__m128i *) &batch.encoder[1][i], r[1]);
+  _mm_storeu_si128((__m128i *) &batch.encoder[2][i], r[2]);
+  _mm_storeu_si128((__m128i *) &batch.gimbal[0][i], _mm_srli_epi16(r[3], GIMBAL_X.shift));
+  _mm_storeu_si128((__m128i *) &batch.gimbal[1][i], _mm_srli_epi16(r[4], GIMBAL_Y.shift));
+  _mm_storeu_si128((__m128i *) &batch.gimbal[2][i], _mm_srli_epi16(r[5], GIMBAL_Z.shift));
+
+  // Status bits are active low
+  __m128i status = _mm_andnot_si128(r[7], _mm_set1_epi16(-1));
+  __m128i b1 = _mm_and_si128(_mm_srli_epi16(status, BUTTON1.shift), one);
+  __m128i b2 = _mm_and_si128(_mm_srli_epi16(status, BUTTON2.shift), one);
+  __m128i dock = _mm_and_si128(_mm_srli_epi16(status, DOCKED.shift), one);
+  _mm_storel_epi64((__m128i *) &batch.button1[i], _mm_packus_epi16(b1, b1));
+  _mm_storel_epi64((__m128i *) &batch.button2[i], _mm_packus_epi16(b2, b2));
+  _mm_storel_epi64((__m128i *) &batch.docked[i], _mm_packus_epi16(dock, dock));
+
+  for (unsigned int j = 0; j < 8; j++)
+  {
+    r[j] = _mm_loadu_si128((const __m128i *) (packets[i + j] + COUNTS_OFFSET));
+  }
+  TRANSPOSE_8X16(, __m128i, r);
+
+  _mm_storeu_si128((__m128i *) &batch.count0[i], _mm_unpacklo_epi16(r[2], r[3]));
+  _mm_storeu_si128((__m128i *) &batch.count0[i + 4], _mm_unpackhi_epi16(r[2], r[3]));
+  _mm_storeu_si128((__m128i *) &batch.count1[i], r[6]);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i loadAvx2(const unsigned char * const *packets, unsigned int i, unsigned int offset)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (packets[i] + offset))),
+      _mm_loadu_si128((const __m128i *) (packets[i + 8] + offset)), 1);
+}
+
+__attribute__ ((target ("avx2")))
+static inline void storeBytesAvx2(uint8_t *destination, __m256i words)
+{
+  // Packing works per lane, so the packets 0-7 end up in quadword 0 and packets 8-15 in quadword 2
+  __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+  _mm_storeu_si128((__m128i *) destination, _mm256_castsi256_si128(bytes));
+}
+
+__attribute__ ((target ("avx2")))
+static void decodeAvx2(const unsigned char * const *packets, unsigned int i, PhantomStateBatch &batch)
+{
+  __m256i r[8], one = _mm256_set1_epi16(1);
+
+  for (unsigned int j = 0; j < 8; j++)
+  {
+    r[j] = loadAvx2(packets, i + j, WORDS_OFFSET);
+  }
+  TRANSPOSE_8X16(256, __m256i, r);
+
+  _mm256_storeu_si256((__m256i *) &batch.encoder[0][i], r[0]);
+  _mm256_storeu_si256((__m256i *) &batch.encoder[1][i], r[1]);
+  _mm256_storeu_si256((__m256i *) &batch.encoder[2][i], r[2]);
+  _mm256_storeu_si256((__m256i *) &batch.gimbal[0][i], _mm256_srli_epi16(r[3], GIMBAL_X.shift));
+  _mm256_storeu_si256((__m256i *) &batch.gimbal[1][i], _mm256_srli_epi16(r[4], GIMBAL_Y.shift));
+  _mm256_storeu_si256((__m256i *) &batch.gimbal[2][i], _mm256_srli_epi16(r[5], GIMBAL_Z.shift));
+
+  __m256i status = _mm256_andnot_si256(r[7], _mm256_set1_epi16(-1));
+  storeBytesAvx2(&batch.button1[i], _mm256_and_si256(_mm256_srli_epi16(status, BUTTON1.shift), one));
+  storeBytesAvx2(&batch.button2[i], _mm256_and_si256(_mm256_srli_epi16(status, BUTTON2.shift), one));
+  storeBytesAvx2(&batch.docked[i], _mm256_and_si256(_mm256_srli_epi16(status, DOCKED.shift), one));
+
+  for (unsigned int j = 0; j < 8; j++)
+  {
+    r[j] = loadAvx2(packets, i + j, COUNTS_OFFSET);
+  }
+  TRANSPOSE_8X16(256, __m256i, r);
+
+  // Interleaving works per lane as well: lo contains packets 0-3 and 8-11, hi contains packets 4-7 and 12-15
+  __m256i lo = _mm256_unpacklo_epi16(r[2], r[3]), hi = _mm256_unpackhi_epi16(r[2], r[3]);
+  _mm256_storeu_si256((__m256i *) &batch.count0[i], _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i *) &batch.count0[i + 8], _mm256_permute2x128_si256(lo, hi, 0x31));
+  _mm256_storeu_si256((__m256i *) &batch.count1[i], r[6]);
+}
+
+#endif
+
+static BatchDecoder::Kernel bestKernel()
+{
+#ifdef BATCH_DECODER_X86
+  if (BatchDecoder::isSupported(BatchDecoder::AVX2))
+    return BatchDecoder::AVX2;
+  if (BatchDecoder::isSupported(BatchDecoder::SSE2))
+    return BatchDecoder::SSE2;
+#endif
+  return BatchDecoder::SCALAR;
+}
+
+static BatchDecoder::Kernel selectedKernel = bestKernel();
+
+unsigned int BatchDecoder::decode(const unsigned char * const *packets, unsigned int count, PhantomStateBatch &batch)
+{
+  unsigned int i = 0;
+
+  if (count > PHANTOM_BATCH_SIZE)
+  {
+    count = PHANTOM_BATCH_SIZE;
+  }
+
+#ifdef BATCH_DECODER_X86
+  switch (selectedKernel)
+  {
+    case AVX2:
+      for (; i + 16 <= count; i += 16)
+      {
+        decodeAvx2(packets, i, batch);
+      }
+      // Fall through: the remaining packets might fit in an SSE2 kernel
+    case SSE2:
+      for (; i + 8 <= count; i += 8)
+      {
+        decodeSse2(packets, i, batch);
+      }
+      break;
+    case SCALAR:
+      break;
+  }
+#endif
+
+  decodeScalar(packets, i, count, batch);
+  batch.count = count;
+  return count;
+}
+
+BatchDecoder::Kernel BatchDecoder::getKernel()
+{
+  return selectedKernel;
+}
+
+bool BatchDecoder::setKernel(Kernel kernel)
+{
+  if (!isSupported(kernel))
+  {
+    return false;
+  }
+  selectedKernel = kernel;
+  return true;
+}
+
+bool BatchDecoder::isSupported(Kernel kernel)
+{
+  switch (kernel)
+  {
+#ifdef BATCH_DECODER_X86
+    case AVX2:
+      // Might be called from a static constructor, before the CPU detection is initialised
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+    case SSE2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2");
+#endif
+    case SCALAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char *BatchDecoder::getKernelName(Kernel kernel)
+{
+  switch (kernel)
+  {
+    case AVX2:
+      return "AVX2";
+    case SSE2:
+      return "SSE2";
+    default:
+      return "scalar";
+  }
+}
@@ -0,0 +1,95 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: decoding a batch of received packets at once (using SIMD instructions when available)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "PhantomPacket.h"
+
+// Maximum number of packets in a PhantomStateBatch
+#define PHANTOM_BATCH_SIZE         64
+
+namespace LibPhantom
+{
+  /**
+   * Decoded states of multiple packets (of one device, or one packet each of multiple devices) as structure of arrays,
+   * see PhantomState for the meaning of the fields
+   */
+  struct PhantomStateBatch
+  {
+    alignas(32) uint16_t encoder[3][PHANTOM_BATCH_SIZE];
+    alignas(32) uint16_t gimbal[3][PHANTOM_BATCH_SIZE];
+    alignas(32) uint32_t count0[PHANTOM_BATCH_SIZE];
+    alignas(32) uint16_t count1[PHANTOM_BATCH_SIZE];
+    alignas(32) uint8_t button1[PHANTOM_BATCH_SIZE];
+    alignas(32) uint8_t button2[PHANTOM_BATCH_SIZE];
+    alignas(32) uint8_t docked[PHANTOM_BATCH_SIZE];
+
+    /**
+     * Number of decoded packets
+     */
+    unsigned int count;
+
+    /**
+     * @return the state of a single packet
+     */
+    void get(unsigned int index, PhantomState &state) const;
+  };
+
+  /**
+   * Decodes received packets into a PhantomStateBatch. The kernel is selected at runtime: AVX2 (16 packets at once) or
+   * SSE2 (8 packets at once) when the CPU supports it, otherwise (or for the remaining packets) the scalar decoder.
+   */
+  class BatchDecoder
+  {
+  public:
+    enum Kernel
+    {
+      SCALAR, SSE2, AVX2
+    };
+
+    /**
+     * @param packets pointers to the packets (of at least PhantomPacketLayout::READ_SIZE bytes each)
+     * @param count number of packets, at most PHANTOM_BATCH_SIZE are decoded
+     * @return number of decoded packets (also stored in batch.count)
+     */
+    static unsigned int decode(const unsigned char * const *packets, unsigned int count, PhantomStateBatch &batch);
+
+    /**
+     * @return the kernel used by decode()
+     */
+    static Kernel getKernel();
+
+    /**
+     * Selects the kernel used by decode() (ie to compare kernels)
+     *
+     * @return false if the CPU does not support the kernel (the kernel is not changed then)
+     */
+    static bool setKernel(Kernel kernel);
+
+    /**
+     * @return true if the CPU supports the kernel
+     */
+    static bool isSupported(Kernel kernel);
+
+    static const char *getKernelName(Kernel kernel);
+  };
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: press/release and dock/undock events, detected once in the receive path
+ */
+
+#include <time.h>
+
+#include "ButtonEvents.h"
+
+using namespace LibPhantom;
+
+// Event types for the bits of ButtonEvents::last when a bit is cleared (active low) and set
+static const PhantomEventType lowEvents[3] = { BUTTON1_PRESSED, BUTTON2_PRESSED, GIMBAL_DOCKED };
+static const PhantomEventType highEvents[3] = { BUTTON1_RELEASED, BUTTON2_RELEASED, GIMBAL_UNDOCKED };
+
+ButtonEvents::ButtonEvents() :
+  head(0), tail(0), dropped(0), last(~0u), callback(0), userdata(0)
+{
+}
+
+bool ButtonEvents::pop(PhantomEvent &event)
+{
+  unsigned int t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  event = events[t & (PHANTOM_EVENT_QUEUE_SIZE - 1)];
+  tail.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+void ButtonEvents::setCallback(PhantomEventCallback callback, void *userdata)
+{
+  this->callback = callback;
+  this->userdata = userdata;
+}
+
+uint64_t ButtonEvents::getDropped() const
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+void ButtonEvents::changed(unsigned int bits, uint32_t count0)
+{
+  if (last == ~0u)
+  {
+    last = bits;
+    return;
+  }
+
+  // Changes are rare, so only then the time is needed
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  double time = ts.tv_sec + ts.tv_nsec * 1e-9;
+
+  unsigned int change = bits ^ last;
+  for (unsigned int bit = 0; bit < 3; bit++)
+  {
+    if (change & (1 << bit))
+    {
+      push(bits & (1 << bit) ? highEvents[bit] : lowEvents[bit], count0, time);
+    }
+  }
+  last = bits;
+}
+
+void ButtonEvents::push(PhantomEventType type, uint32_t count0, double time)
+{
+  PhantomEvent event;
+  event.type = type;
+  event.count0 = count0;
+  event.time = time;
+
+  unsigned int h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) == PHANTOM_EVENT_QUEUE_SIZE)
+  {
+    dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+  else
+  {
+    events[h & (PHANTOM_EVENT_QUEUE_SIZE - 1)] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  if (callback)
+  {
+    callback(&event, userdata);
+  }
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: press/release and dock/undock events, detected once in the receive path
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "PhantomPacket.h"
+
+// Number of events which can be pending before events get dropped (a power of 2)
+#define PHANTOM_EVENT_QUEUE_SIZE 64
+
+namespace LibPhantom
+{
+  enum PhantomEventType
+  {
+    BUTTON1_PRESSED,
+    BUTTON1_RELEASED,
+    BUTTON2_PRESSED,
+    BUTTON2_RELEASED,
+    GIMBAL_DOCKED,
+    GIMBAL_UNDOCKED
+  };
+
+  struct PhantomEvent
+  {
+    PhantomEventType type;
+
+    /**
+     * Message counter of the packet in which the change was seen
+     */
+    uint32_t count0;
+
+    /**
+     * Time (CLOCK_MONOTONIC, in seconds) at which the packet was received
+     */
+    double time;
+  };
+
+  typedef void (*PhantomEventCallback)(const PhantomEvent *event, void *userdata);
+
+  /**
+   * Compares the button and dock bits of each received packet with the previous packet. Every change is queued (in a
+   * single producer, single consumer ring) and passed to the callback (in the receiving thread). The first packet only
+   * sets the initial state, see PhantomState for that.
+   */
+  class ButtonEvents
+  {
+  public:
+    ButtonEvents();
+
+    /**
+     * Called for every received packet (of PhantomPacketLayout::READ_SIZE bytes)
+     */
+    void received(const unsigned char *packet)
+    {
+      using namespace PhantomPacketLayout;
+
+      unsigned int bits = readField(packet, BUTTON1) | readField(packet, BUTTON2) << 1 | readField(packet, DOCKED) << 2;
+      if (bits != last)
+      {
+        changed(bits, readField(packet, COUNT0));
+      }
+    }
+
+    /**
+     * Takes the oldest event from the queue, may only be called by a single thread at a time
+     *
+     * @return false if there is no event
+     */
+    bool pop(PhantomEvent &event);
+
+    /**
+     * Sets the callback which is called by the receiving thread for every event (the events are queued as well)
+     */
+    void setCallback(PhantomEventCallback callback, void *userdata);
+
+    /**
+     * @return the number of events dropped because the queue was full
+     */
+    uint64_t getDropped() const;
+
+    /**
+     * @return true if the gimbal was docked in the last packet, may only be called by the receiving thread
+     */
+    bool isDocked() const
+    {
+      return last != ~0u && !(last & 4);
+    }
+
+  private:
+    PhantomEvent events[PHANTOM_EVENT_QUEUE_SIZE];
+    std::atomic<unsigned int> head; // Only written by the receiving thread
+    std::atomic<unsigned int> tail; // Only written by the consuming thread
+    std::atomic<uint64_t> dropped;
+
+    /**
+     * Status bits of the previous packet (as in the packet, so active low), or ~0 before the first packet
+     */
+    unsigned int last;
+
+    PhantomEventCallback callback;
+    void *userdata;
+
+    void changed(unsigned int bits, uint32_t count0);
+    void push(PhantomEventType type, uint32_t count0, double time);
+  };
+}
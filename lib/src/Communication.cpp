@@ -73,12 +73,12 @@ void Communication::startXmitIsoTransfer(unsigned int channel, PhantomIsoChannel
   this->iso_channel = iso_channel;
 }
 
-void Communication::callbackRecvHandler(unsigned char *data, unsigned int len)
+bool Communication::pollIterate()
 {
-  iso_channel->receivedData(data, len);
+  doIterate();
+  return true;
 }
 
-void Communication::callbackXmitHandler(unsigned char *data, unsigned int *len)
+void Communication::setIrqInterval(unsigned int packets)
 {
-  iso_channel->transmitData(data, len);
 }
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <sys/types.h>
+#include "PhantomIsoChannel.h"
 
 namespace LibPhantom
 {
@@ -50,6 +51,19 @@ namespace LibPhantom
     virtual void startXmitIsoTransfer(unsigned int channel, PhantomIsoChannel *iso_channel);
     virtual void stopIsoTransfer()=0;
     virtual void doIterate()=0;
+
+    /**
+     * Non-blocking version of doIterate(), for busy polling: only handles the events which are pending
+     *
+     * @return true if there were events. Platforms without a non-blocking iteration block in doIterate() instead.
+     */
+    virtual bool pollIterate();
+
+    /**
+     * Sets after how many received packets the driver wakes up the iterating thread (by default after every packet).
+     * Platforms which cannot change this ignore it.
+     */
+    virtual void setIrqInterval(unsigned int packets);
   protected:
     /**
      * Isochronous channel object
@@ -58,8 +72,16 @@ namespace LibPhantom
 
     Communication();
   public: //TODO: protected!
-    void callbackRecvHandler(unsigned char *data, unsigned int len);
-    void callbackXmitHandler(unsigned char *data, unsigned int *len);
+    // Inline, so the isochronous handler of the platform calls the application callback directly
+    void callbackRecvHandler(unsigned char *data, unsigned int len, unsigned int dropped = 0)
+    {
+      iso_channel->receivedData(data, len, dropped);
+    }
+
+    void callbackXmitHandler(unsigned char *data, unsigned int *len, unsigned int dropped = 0)
+    {
+      iso_channel->transmitData(data, len, dropped);
+    }
   };
 }
 
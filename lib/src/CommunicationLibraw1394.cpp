@@ -20,16 +20,21 @@
  */
 
 #include <errno.h>
+#include <poll.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "CommunicationLibraw1394.h"
 #include "DeviceIteratorLibraw1394.h"
+#include "Log.h"
+
+// Number of times a read is retried while the device is busy (EAGAIN)
+#define MAX_BUSY_RETRIES           100
 
 using namespace LibPhantom;
 
 CommunicationLibraw1394::CommunicationLibraw1394(unsigned int port, nodeid_t node) :
-  node(node)
+  node(node), recvChannel(-1), irqInterval(1)
 {
   handle = raw1394_new_handle_on_port(port);
   // Add pointer to ourself to the handle, so the callback functions can be used more easily
@@ -48,7 +53,32 @@ void CommunicationLibraw1394::read(u_int64_t address, char *buffer, unsigned int
 
 void CommunicationLibraw1394::read(nodeid_t node, u_int64_t address, char *buffer, unsigned int length)
 {
-  int pos = 0;
+  read(handle, node, address, buffer, length);
+}
+
+void CommunicationLibraw1394::read(raw1394_handle *handle, nodeid_t node, u_int64_t address, char *buffer,
+    unsigned int length)
+{
+  unsigned int pos = 0, busy = 0;
+
+  // Try to read quadlet aligned blocks at once, fall back to quadlet reads when the device does not allow this
+  if (length > 4 && length % 4 == 0)
+  {
+    int ret;
+    while ((ret = raw1394_read(handle, node, address, length, (quadlet_t *) buffer)) && errno == EAGAIN)
+    {
+      if (++busy >= MAX_BUSY_RETRIES)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Device stayed busy while reading";
+      }
+    }
+    if (ret == 0)
+    {
+      return;
+    }
+  }
+
   // The new Linux firewire stack does not allow reads from its host device with larger blocks than quadlets
   while (pos < length)
   {
@@ -62,10 +92,16 @@ void CommunicationLibraw1394::read(nodeid_t node, u_int64_t address, char *buffe
             strerror(errno));
         throw buffer;
       }
+      if (++busy >= MAX_BUSY_RETRIES)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Device stayed busy while reading";
+      }
     }
     else
     {
       pos += 4;
+      busy = 0;
     }
   }
 }
@@ -96,7 +132,8 @@ void CommunicationLibraw1394::startRecvIsoTransfer(unsigned int channel, Phantom
 {
   Communication::startRecvIsoTransfer(channel, iso_channel);
 
-  raw1394_iso_recv_init(handle, &recv_handler, 1000, 64, channel, RAW1394_DMA_DEFAULT, 1);
+  recvChannel = channel;
+  raw1394_iso_recv_init(handle, &recv_handler, 1000, 64, channel, RAW1394_DMA_DEFAULT, irqInterval);
   raw1394_iso_recv_start(handle, -1, -1, 0);
 }
 
@@ -111,6 +148,44 @@ void CommunicationLibraw1394::startXmitIsoTransfer(unsigned int channel, Phantom
 void CommunicationLibraw1394::stopIsoTransfer()
 {
   raw1394_iso_shutdown( handle);
+  recvChannel = -1;
+}
+
+bool CommunicationLibraw1394::pollIterate()
+{
+  // Let the kernel hand over the packets received so far, without waiting for the interrupt interval
+  if (recvChannel >= 0)
+  {
+    raw1394_iso_recv_flush(handle);
+  }
+
+  struct pollfd fd;
+  fd.fd = raw1394_get_fd(handle);
+  fd.events = POLLIN;
+  if (::poll(&fd, 1, 0) != 1)
+  {
+    return false;
+  }
+
+  doIterate();
+  return true;
+}
+
+void CommunicationLibraw1394::setIrqInterval(unsigned int packets)
+{
+  if (packets == irqInterval)
+  {
+    return;
+  }
+  irqInterval = packets;
+
+  // The interval is a parameter of the receive context, so restart it (a few packets might get lost)
+  if (recvChannel >= 0)
+  {
+    raw1394_iso_shutdown(handle);
+    raw1394_iso_recv_init(handle, &recv_handler, 1000, 64, recvChannel, RAW1394_DMA_DEFAULT, irqInterval);
+    raw1394_iso_recv_start(handle, -1, -1, 0);
+  }
 }
 
 void CommunicationLibraw1394::doIterate()
@@ -130,7 +205,11 @@ enum raw1394_iso_disposition CommunicationLibraw1394::recv_handler(raw1394handle
     unsigned int dropped)
 {
   CommunicationLibraw1394 *com = (CommunicationLibraw1394 *) raw1394_get_userdata(handle);
-  com->callbackRecvHandler(data, len);
+  if (dropped)
+  {
+    PHANTOM_LOG_WARNING("Dropped %u packet(s) before cycle %u on receive channel %u", dropped, cycle, channel);
+  }
+  com->callbackRecvHandler(data, len, dropped);
   return RAW1394_ISO_OK;
 }
 
@@ -138,7 +217,11 @@ enum raw1394_iso_disposition CommunicationLibraw1394::xmit_handler(raw1394handle
     unsigned int *len, unsigned char *tag, unsigned char *sy, int cycle, unsigned int dropped)
 {
   CommunicationLibraw1394 *com = (CommunicationLibraw1394 *) raw1394_get_userdata(handle);
-  com->callbackXmitHandler(data, len);
+  if (dropped)
+  {
+    PHANTOM_LOG_WARNING("Dropped %u packet(s) before cycle %d on transmit channel", dropped, cycle);
+  }
+  com->callbackXmitHandler(data, len, dropped);
   *tag = 0;
   *sy = 0;
 
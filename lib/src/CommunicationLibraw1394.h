@@ -42,6 +42,14 @@ namespace LibPhantom
     virtual void read(u_int64_t address, char *buffer, unsigned int length);
     void read(nodeid_t node, u_int64_t address, char *buffer, unsigned int length);
 
+    /**
+     * Reads data from the node using the given handle (instead of the handle of a Communication object). A busy device
+     * (EAGAIN) is retried a limited number of times.
+     *
+     * @throws some exception when the read failed or the device stayed busy
+     */
+    static void read(raw1394_handle *handle, nodeid_t node, u_int64_t address, char *buffer, unsigned int length);
+
     virtual void write(u_int64_t address, char *buffer, unsigned int length);
     void write(nodeid_t node, u_int64_t address, char *buffer, unsigned int length);
 
@@ -49,6 +57,8 @@ namespace LibPhantom
     virtual void startXmitIsoTransfer(unsigned int channel, PhantomIsoChannel *iso_channel);
     virtual void stopIsoTransfer();
     virtual void doIterate();
+    virtual bool pollIterate();
+    virtual void setIrqInterval(unsigned int packets);
   protected:
 
    /**
@@ -61,6 +71,12 @@ namespace LibPhantom
      */
     raw1394_handle *handle;
 
+    /**
+     * Receiving channel (-1 when not receiving) and its interrupt interval (in packets)
+     */
+    int recvChannel;
+    unsigned int irqInterval;
+
   private:
     static enum raw1394_iso_disposition xmit_handler(raw1394handle_t handle, unsigned char *data, unsigned int *len,
         unsigned char *tag, unsigned char *sy, int cycle, unsigned int dropped);
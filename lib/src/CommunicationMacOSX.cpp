@@ -20,6 +20,7 @@
  */
 
 #include "CommunicationMacOSX.h"
+#include "Log.h"
 #include <iostream>
 
 #import <mach/mach.h>
@@ -77,7 +78,7 @@ DCLCallbackHandler( DCLCommand* dcl )
 	static int count = 0 ;
 
 	count++;
-	printf("isoch callback %u\n", count) ;
+	PHANTOM_LOG_TRACE("isoch callback %u", count);
 
 	DCLCallProcStruct *pCallProc =  (DCLCallProcStruct*) dcl;
 	CommunicationMacOSX *com = (CommunicationMacOSX*) pCallProc->procData;
@@ -222,12 +223,12 @@ void CommunicationMacOSX::stopIsoTransfer() {
 void CommunicationMacOSX::doIterate(){
 	SInt16	runLoopResult ;
 
-	printf("doIterate called\n");
+	PHANTOM_LOG_TRACE("doIterate called");
 	while (  kCFRunLoopRunHandledSource == ( runLoopResult = CFRunLoopRunInMode( kCFRunLoopDefaultMode, 1, true ) ) )
 	{
-		printf("x\n");
+		PHANTOM_LOG_TRACE("x");
 	}
-	printf("end of iterate\n");
+	PHANTOM_LOG_TRACE("end of iterate");
 
 //	throw "Not implemented doiterate";
 }
@@ -0,0 +1,264 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: IEEE 1212 config ROM decoding
+ */
+
+#include <string.h>
+#include <netinet/in.h> // ntohl
+
+#include "ConfigRom.h"
+
+// "1394" in ASCII, first quadlet of the bus info block
+#define BUS_NAME_1394              0x31333934
+
+using namespace LibPhantom;
+
+u_int16_t LibPhantom::configRomCrc(const u_int32_t *quadlets, unsigned int length)
+{
+  // Calculated 4 bits at a time, as described in IEEE 1212 (7.3)
+  u_int32_t crc = 0;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    u_int32_t data = quadlets[i];
+    for (int shift = 28; shift >= 0; shift -= 4)
+    {
+      u_int32_t sum = ((crc >> 12) ^ (data >> shift)) & 0xf;
+      crc = (crc << 4) ^ (sum << 12) ^ (sum << 5) ^ sum;
+    }
+    crc &= 0xffff;
+  }
+  return crc;
+}
+
+void LibPhantom::configRomToHostOrder(u_int32_t *quadlets, unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++)
+  {
+    quadlets[i] = ntohl(quadlets[i]);
+  }
+}
+
+/**
+ * Checks whether the block (directory or leaf) at index is available and valid
+ *
+ * @return the number of quadlets needed to check the block (larger than length when the block is not complete), or 0 when
+ *         the block does not fit in the config ROM at all
+ */
+static unsigned int checkBlock(const u_int32_t *rom, unsigned int length, unsigned int index, struct config_rom *crom)
+{
+  if (index >= CONFIG_ROM_QUADLETS)
+  {
+    return 0;
+  }
+  if (index >= length)
+  {
+    return index + 1;
+  }
+
+  unsigned int end = index + 1 + (rom[index] >> 16);
+  if (end > CONFIG_ROM_QUADLETS)
+  {
+    return 0;
+  }
+  if (end > length)
+  {
+    return end;
+  }
+
+  if (configRomCrc(rom + index + 1, rom[index] >> 16) != (rom[index] & 0xffff))
+  {
+    crom->crc_valid = false;
+  }
+  return end;
+}
+
+static void decodeText(const u_int32_t *rom, unsigned int index, char *text, unsigned int max)
+{
+  // A textual descriptor leaf starts with the specifier id and language id quadlets, followed by the (padded) text
+  unsigned int bytes = ((rom[index] >> 16) - 2) * 4;
+  const u_int32_t *q = rom + index + 3;
+  unsigned int i;
+
+  for (i = 0; i < bytes && i < max - 1; i++)
+  {
+    text[i] = (q[i / 4] >> (24 - 8 * (i % 4))) & 0xff;
+  }
+  text[i] = 0;
+}
+
+unsigned int LibPhantom::decodeConfigRom(const u_int32_t *rom, unsigned int length, struct config_rom *crom)
+{
+  unsigned int i, needed, end, value;
+  unsigned int unit_dir = 0, vendor_leaf = 0, unique_id_leaf = 0;
+
+  memset(crom, 0, sizeof(struct config_rom));
+  crom->crc_valid = true;
+
+  if (length < 1)
+  {
+    return 1;
+  }
+
+  /* If the length isn't 4 it means the node doesn't have a general ROM
+   * format and instead contains only a 24 bit vendor ID.
+   */
+  unsigned int info_length = rom[0] >> 24;
+  if (info_length != 4)
+  {
+    crom->vendor_id = rom[0] & 0x00ffffff;
+    return 1;
+  }
+
+  // The bus info block is followed by the header of the root directory
+  unsigned int crc_length = (rom[0] >> 16) & 0xff;
+  unsigned int root = 1 + info_length;
+  needed = root + 1 > 1 + crc_length ? root + 1 : 1 + crc_length;
+  if (needed > CONFIG_ROM_QUADLETS)
+  {
+    return 0;
+  }
+  if (needed > length)
+  {
+    return needed;
+  }
+
+  if (rom[1] != BUS_NAME_1394)
+  {
+    return 0;
+  }
+
+  // The CRC of the bus info block covers crc_length quadlets (which might include the whole config ROM)
+  if (configRomCrc(rom + 1, crc_length) != (rom[0] & 0xffff))
+  {
+    crom->crc_valid = false;
+  }
+
+  crom->irm_cap = rom[2] >> 31;
+  crom->cycle_master_cap = (rom[2] >> 30) & 0x01;
+  crom->iso_cap = (rom[2] >> 29) & 0x01;
+  crom->bus_manager_cap = (rom[2] >> 28) & 0x01;
+  crom->cycle_clk_accuracy = (rom[2] >> 16) & 0xff;
+  crom->max_async_bwrite_payload = 2 << ((rom[2] >> 12) & 0x0f);
+  crom->link_speed = rom[2] & 7;
+
+  crom->vendor_id = rom[3] >> 8;
+  crom->guid_hi = rom[3] & 0xff;
+  crom->guid_lo = rom[4];
+
+  end = checkBlock(rom, length, root, crom);
+  if (end == 0 || end > length)
+  {
+    return end;
+  }
+
+  /* Scan the root directory for entries of interest. These quadlets are key-value pairs; the key is in the upper 8 bits
+   * of the quadlet. For leaves and directories, the value is the offset (in quadlets) relative to the entry itself.
+   */
+  for (i = root + 1; i < end; i++)
+  {
+    value = rom[i] & 0x00ffffff;
+    switch (rom[i] >> 24)
+    {
+    case 0x0c:
+      crom->node_capabilities = value;
+      break;
+    case 0x17:
+      crom->model_id = value;
+      break;
+    case 0xd1:
+      unit_dir = i + value;
+      break;
+    case 0x8d:
+      unique_id_leaf = i + value;
+      break;
+    case 0x81:
+      // Textual descriptor of the preceding entry, only the first one (which belongs to the vendor id) is used
+      if (vendor_leaf == 0)
+      {
+        vendor_leaf = i + value;
+      }
+      break;
+    }
+  }
+  needed = end;
+
+  // Next come the unit directory and leaves. All of them need to be available before they are decoded.
+  unsigned int blocks[3] = { unit_dir, unique_id_leaf, vendor_leaf };
+  bool complete = true;
+  for (i = 0; i < 3; i++)
+  {
+    if (blocks[i] == 0)
+    {
+      continue;
+    }
+    end = checkBlock(rom, length, blocks[i], crom);
+    if (end == 0)
+    {
+      // Invalid offset, ignore this entry
+      blocks[i] = 0;
+      continue;
+    }
+    if (end > length)
+    {
+      complete = false;
+    }
+    if (end > needed)
+    {
+      needed = end;
+    }
+  }
+  if (!complete)
+  {
+    return needed;
+  }
+
+  if (blocks[0])
+  {
+    end = blocks[0] + 1 + (rom[blocks[0]] >> 16);
+    for (i = blocks[0] + 1; i < end; i++)
+    {
+      /* Also, the unit dir has key-value pairs */
+      value = rom[i] & 0x00ffffff;
+      switch (rom[i] >> 24)
+      {
+      case 0x12:
+        crom->unit_spec_id = value;
+        break;
+      case 0x13:
+        crom->unit_sw_version = value;
+        break;
+      case 0x17:
+        crom->model_id = value;
+        break;
+      }
+    }
+  }
+
+  if (blocks[1] && (rom[blocks[1]] >> 16) >= 2)
+  {
+    crom->node_unique_id = ((u_int64_t) rom[blocks[1] + 1]) << 32 | rom[blocks[1] + 2];
+  }
+
+  if (blocks[2] && (rom[blocks[2]] >> 16) > 2)
+  {
+    decodeText(rom, blocks[2], crom->vendor, CONFIG_ROM_MAX_VENDOR);
+  }
+
+  return needed;
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: IEEE 1212 config ROM decoding
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+// The config ROM occupies 1 kB of the CSR address space (CSR_CONFIG_ROM up to CSR_CONFIG_ROM_END)
+#define CONFIG_ROM_QUADLETS        256
+
+// Maximum length (including '\0') of the vendor name that is kept from the textual descriptor leaf
+#define CONFIG_ROM_MAX_VENDOR      64
+
+namespace LibPhantom
+{
+  //TODO Take a look at the fields and remove the ones which do not influence finding PHANTOM devices (ie vendor name)
+
+  struct config_rom
+  {
+    unsigned char motu_fw_audio :1;
+    unsigned char irm_cap :1;
+    unsigned char cycle_master_cap :1;
+    unsigned char iso_cap :1;
+    unsigned char bus_manager_cap :1;
+    unsigned char cycle_clk_accuracy;
+    unsigned int max_async_bwrite_payload;
+    unsigned int link_speed;
+    union
+    {
+      struct
+      {
+        u_int32_t guid_lo;
+        u_int32_t guid_hi;
+      };
+      u_int64_t guid;
+    };
+    u_int32_t node_capabilities;
+    u_int32_t vendor_id;
+    u_int32_t unit_spec_id;
+    u_int32_t unit_sw_version;
+    u_int32_t model_id;
+
+    /**
+     * Contents of the node unique id leaf (key 0x8d), or 0 when not present
+     */
+    u_int64_t node_unique_id;
+
+    /**
+     * False when the CRC of the bus info block or of one of the decoded directories/leaves did not match
+     */
+    bool crc_valid;
+
+    /**
+     * Vendor name from the textual descriptor leaf, empty when not present
+     */
+    char vendor[CONFIG_ROM_MAX_VENDOR];
+  };
+
+  /**
+   * @return the IEEE 1212 CRC-16 of the given quadlets (in host byte order)
+   */
+  u_int16_t configRomCrc(const u_int32_t *quadlets, unsigned int length);
+
+  /**
+   * Converts quadlets as read from the bus (big endian) to host byte order, in place
+   */
+  void configRomToHostOrder(u_int32_t *quadlets, unsigned int length);
+
+  /**
+   * Decodes a config ROM image. The image is only read, nothing gets copied except for the decoded values.
+   *
+   * Since the size of a config ROM is only known while decoding it, the image can be incomplete: in that case the image
+   * needs to be extended with (at least) the returned number of quadlets after which it can be decoded again.
+   *
+   * @param rom the config ROM image, in host byte order (see configRomToHostOrder())
+   * @param length number of quadlets available in rom
+   * @param crom is filled with the decoded values
+   * @return the number of quadlets needed to decode the config ROM completely (which is at most CONFIG_ROM_QUADLETS),
+   *         or 0 when the image does not contain a valid config ROM
+   */
+  unsigned int decodeConfigRom(const u_int32_t *rom, unsigned int length, struct config_rom *crom);
+}
@@ -31,10 +31,43 @@
 
 using namespace LibPhantom;
 
-DeviceIterator* DeviceIterator::createInstance()
+DeviceIterator::~DeviceIterator()
+{
+  for (std::vector<FirewireDevice*>::iterator it = unclaimed.begin(); it != unclaimed.end(); it++)
+  {
+    delete *it;
+  }
+}
+
+DeviceProbe* DeviceIterator::nextProbe()
+{
+  // Without a platform specific implementation, a probe simply is a full device
+  FirewireDevice *device = next();
+  if (device)
+  {
+    unclaimed.push_back(device);
+  }
+  return device;
+}
+
+FirewireDevice* DeviceIterator::claim(DeviceProbe *probe)
+{
+  for (std::vector<FirewireDevice*>::iterator it = unclaimed.begin(); it != unclaimed.end(); it++)
+  {
+    if (*it == probe)
+    {
+      unclaimed.erase(it);
+      return (FirewireDevice *) probe;
+    }
+  }
+  // TODO Create some library exception and throw that one
+  throw "Probe does not belong to this iterator or is claimed already";
+}
+
+DeviceIterator* DeviceIterator::createInstance(bool skipOpenDevices)
 {
 #ifdef USE_libraw1394
-  return new DeviceIteratorLibraw1394;
+  return new DeviceIteratorLibraw1394(skipOpenDevices);
 #endif
 #ifdef USE_macosx
   return new DeviceIteratorMacOSX;
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <vector>
+#include "DeviceProbe.h"
 #include "FirewireDevice.h"
 
 namespace LibPhantom
@@ -28,8 +30,35 @@ namespace LibPhantom
   class DeviceIterator
   {
   public:
-    static DeviceIterator *createInstance();
+    /**
+     * @param skipOpenDevices when false, devices which are in use (open) already are returned as well
+     */
+    static DeviceIterator *createInstance(bool skipOpenDevices = true);
+    virtual ~DeviceIterator();
+
+    /**
+     * @return the next device (which is owned by the caller), or 0 when there are no more devices
+     */
     virtual FirewireDevice* next()=0;
+
+    /**
+     * Finds the next device without claiming it, which is much cheaper when most devices are not used anyway.
+     *
+     * @return the next device, or 0 when there are no more devices. The probe is owned by the iterator and is only valid
+     *         while the iterator exists.
+     */
+    virtual DeviceProbe* nextProbe();
+
+    /**
+     * @return the device to communicate with the device of the given probe (which is owned by the caller)
+     */
+    virtual FirewireDevice* claim(DeviceProbe *probe);
+
+  protected:
+    /**
+     * Devices returned by the default nextProbe() implementation which are not claimed (yet)
+     */
+    std::vector<FirewireDevice*> unclaimed;
   };
 }
 
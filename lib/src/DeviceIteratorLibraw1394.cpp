@@ -20,39 +20,78 @@
  */
 
 #include <stdlib.h>     // NULL
+#include <new>          // placement new
+#include <netinet/in.h> // ntohl
+#include "libraw1394/csr.h"
+
 #include "DeviceIteratorLibraw1394.h"
+#include "DeviceProbeLibraw1394.h"
 #include "FirewireDeviceLibraw1394.h"
 
+#define TOPOLOGY_MAP_ADDR    CSR_REGISTER_BASE + CSR_TOPOLOGY_MAP
+
+// Fields of a self-ID packet (IEEE 1394-1995 4.3.4.1)
+#define SELF_ID_IS_SELF_ID(q)      (((q) >> 30) == 2)
+#define SELF_ID_PHY_ID(q)          (((q) >> 24) & 0x3f)
+#define SELF_ID_IS_EXTENDED(q)     (((q) >> 23) & 0x01)
+#define SELF_ID_LINK_ACTIVE(q)     (((q) >> 22) & 0x01)
+
+// Arena memory needed for a probe and its config ROM image
+#define PROBE_SIZE                 (sizeof(DeviceProbeLibraw1394) + CONFIG_ROM_QUADLETS * sizeof(u_int32_t))
+
+// Most busses only have a few nodes, so a single block is usually enough
+#define PROBES_PER_BLOCK           16
+
+#define NODE_BIT(node)             (((u_int64_t) 1) << ((node) & 0x3f))
+
 using namespace LibPhantom;
 
 // Number of ports is not available yet
-// TODO On bus-reset set ports back to -1
 int DeviceIteratorLibraw1394::ports = -1;
 
-DeviceIteratorLibraw1394::DeviceIteratorLibraw1394() :
-  port(0), node(0)
+std::vector<PortTopology> DeviceIteratorLibraw1394::topologies;
+
+std::mutex DeviceIteratorLibraw1394::topologyMutex;
+
+DeviceIteratorLibraw1394::DeviceIteratorLibraw1394(bool skipOpenDevices) :
+  skipOpenDevices(skipOpenDevices), port(0), node(0), handle(0), arena(PROBES_PER_BLOCK * PROBE_SIZE), topology()
 {
   if (getPorts() == 0)
   {
     nodes = 0;
-    handle = 0;
   }
   else
   {
-    handle = raw1394_new_handle_on_port(0);
-    nodes = raw1394_get_nodecount(handle);
+    openPort(0);
   }
 }
 
 DeviceIteratorLibraw1394::~DeviceIteratorLibraw1394()
 {
-  if (handle)
+  // The probes do not own any resources, so their memory is released with the arena (without calling destructors)
+  for (std::vector<raw1394_handle *>::iterator it = handles.begin(); it != handles.end(); it++)
   {
-    raw1394_destroy_handle( handle);
+    raw1394_destroy_handle(*it);
   }
 }
 
 FirewireDevice* DeviceIteratorLibraw1394::next()
+{
+  DeviceProbe *probe = nextProbe();
+  return probe ? claim(probe) : NULL;
+}
+
+FirewireDevice* DeviceIteratorLibraw1394::claim(DeviceProbe *probe)
+{
+  DeviceProbeLibraw1394 *p = (DeviceProbeLibraw1394 *) probe;
+  FirewireDevice *device = new FirewireDeviceLibraw1394(p->getPort(), p->getNode());
+
+  // Prevent reading the config ROM again
+  device->copyConfigRom(probe);
+  return device;
+}
+
+DeviceProbe* DeviceIteratorLibraw1394::nextProbe()
 {
   for (;;)
   {
@@ -63,35 +102,165 @@ FirewireDevice* DeviceIteratorLibraw1394::next()
       {
         return NULL;
       }
-      raw1394_destroy_handle( handle);
-      handle = raw1394_new_handle_on_port(port);
-      nodes = raw1394_get_nodecount(handle);
-      node = 0;
+      openPort(port);
     }
 
-    if (!FirewireDeviceLibraw1394::deviceIsOpen(port, node | 0xffc0))
+    // Skip the local node, nodes without active link and nodes which did not respond before
+    if (!(topology.active_nodes & NODE_BIT(node)) || (topology.unresponsive_nodes & NODE_BIT(node)))
+    {
+      node++;
+      continue;
+    }
+
+    if (!skipOpenDevices || !FirewireDeviceLibraw1394::deviceIsOpen(port, node | 0xffc0))
     {
       // Firewire nodes start at 0xffc0 and counts upwards (see specs... something about local bus address)
-      FirewireDevice *device = new FirewireDeviceLibraw1394(port, node | 0xffc0);
+      char *memory = (char *) arena.allocate(PROBE_SIZE);
+      u_int32_t *configRomData = (u_int32_t *) (memory + sizeof(DeviceProbeLibraw1394));
+      DeviceProbe *probe = new (memory) DeviceProbeLibraw1394(handle, port, node | 0xffc0, configRomData);
+
+      // Read the config ROM now, so a node that does not respond is skipped already during this enumeration
+      probe->getConfigRom();
+      if (isUnresponsive(port, node | 0xffc0))
+      {
+        topology.unresponsive_nodes |= NODE_BIT(node);
+        node++;
+        continue;
+      }
       node++;
-      return device;
+      return probe;
     }
     node++;
   }
 }
 
+void DeviceIteratorLibraw1394::markUnresponsive(int port, nodeid_t node)
+{
+  std::lock_guard<std::mutex> lock(topologyMutex);
+  if (port < 0 || (unsigned int) port >= topologies.size())
+  {
+    return;
+  }
+  topologies[port].unresponsive_nodes |= NODE_BIT(node);
+}
+
+bool DeviceIteratorLibraw1394::isUnresponsive(int port, nodeid_t node)
+{
+  std::lock_guard<std::mutex> lock(topologyMutex);
+  if (port < 0 || (unsigned int) port >= topologies.size())
+  {
+    return false;
+  }
+  return topologies[port].unresponsive_nodes & NODE_BIT(node);
+}
+
+void DeviceIteratorLibraw1394::resetPorts()
+{
+  std::lock_guard<std::mutex> lock(topologyMutex);
+  ports = -1;
+}
+
 int DeviceIteratorLibraw1394::getPorts()
 {
+  std::lock_guard<std::mutex> lock(topologyMutex);
   if (ports == -1)
   {
     raw1394handle_t h = raw1394_new_handle();
     if (h == 0)
     {
-      // TODO Throw error
+      // TODO Create some library exception and throw that one
+      throw "Could not create libraw1394 handle";
     }
     // Cache value, since we assume it will not change
-    ports = raw1394_get_port_info(h, 0, 0);
+    int count = raw1394_get_port_info(h, 0, 0);
     raw1394_destroy_handle(h);
+    if (count < 0)
+    {
+      // TODO Create some library exception and throw that one
+      throw "Could not get port info";
+    }
+    ports = count;
+    topologies.resize(ports);
   }
   return ports;
 }
+
+void DeviceIteratorLibraw1394::openPort(int port)
+{
+  raw1394handle_t h = raw1394_new_handle_on_port(port);
+  if (h == 0)
+  {
+    // TODO Create some library exception and throw that one
+    throw "Could not create libraw1394 handle on port";
+  }
+  handle = h;
+  handles.push_back(handle);
+  nodes = raw1394_get_nodecount(handle);
+  node = 0;
+
+  unsigned int generation = raw1394_get_generation(handle);
+  {
+    std::lock_guard<std::mutex> lock(topologyMutex);
+    if (port < (int) topologies.size() && topologies[port].valid && topologies[port].generation == generation)
+    {
+      // Nothing changed since the last time this port was scanned
+      topology = topologies[port];
+      return;
+    }
+  }
+
+  // A bus reset occurred (or the port was not scanned before), so the node numbering might have changed
+  topology.valid = true;
+  topology.generation = generation;
+  topology.unresponsive_nodes = 0;
+  if (!readTopology())
+  {
+    // Fall back to trying every node (except for ourselves)
+    topology.active_nodes = nodes >= 64 ? ~((u_int64_t) 0) : NODE_BIT(nodes) - 1;
+  }
+  topology.active_nodes &= ~NODE_BIT(raw1394_get_local_id(handle));
+
+  // The topology map is read without holding the lock, so another iterator might have stored this generation already
+  std::lock_guard<std::mutex> lock(topologyMutex);
+  if (port < (int) topologies.size() && !(topologies[port].valid && topologies[port].generation == generation))
+  {
+    topologies[port] = topology;
+  }
+}
+
+bool DeviceIteratorLibraw1394::readTopology()
+{
+  quadlet_t quadlet;
+  nodeid_t local = raw1394_get_local_id(handle);
+  u_int64_t addr = TOPOLOGY_MAP_ADDR;
+
+  // The new Linux firewire stack does not allow reads from its host device with larger blocks than quadlets
+  // Skip the length/crc and generation quadlets, the third one contains the number of self-ID packets
+  if (raw1394_read(handle, local, addr + 8, 4, &quadlet))
+  {
+    return false;
+  }
+  unsigned int self_id_count = ntohl(quadlet) & 0xffff;
+
+  topology.active_nodes = 0;
+  addr += 12;
+  for (unsigned int i = 0; i < self_id_count; i++, addr += 4)
+  {
+    if (raw1394_read(handle, local, addr, 4, &quadlet))
+    {
+      return false;
+    }
+    quadlet = ntohl(quadlet);
+
+    // Only the first self-ID packet of a node contains the link state
+    if (!SELF_ID_IS_SELF_ID(quadlet) || SELF_ID_IS_EXTENDED(quadlet))
+    {
+      continue;
+    }
+    if (SELF_ID_LINK_ACTIVE(quadlet))
+    {
+      topology.active_nodes |= NODE_BIT(SELF_ID_PHY_ID(quadlet));
+    }
+  }
+  return true;
+}
@@ -21,21 +21,67 @@
 
 #pragma once
 
+#include <mutex>
+#include <vector>
 #include "libraw1394/raw1394.h"
 
+#include "Arena.h"
 #include "DeviceIterator.h"
 
 namespace LibPhantom
 {
+  /**
+   * Topology information of a port, which is only valid for the bus generation it was read in
+   */
+  struct PortTopology
+  {
+    /**
+     * When false, the topology was not read yet
+     */
+    bool valid;
+
+    /**
+     * Bus generation in which the topology was read
+     */
+    unsigned int generation;
+
+    /**
+     * Bit n is set when node n has an active link layer (the local node is never set)
+     */
+    u_int64_t active_nodes;
+
+    /**
+     * Bit n is set when node n did not respond to a request in this generation
+     */
+    u_int64_t unresponsive_nodes;
+  };
+
   class DeviceIteratorLibraw1394 : public DeviceIterator
   {
   public:
     //TODO: friend??
-    DeviceIteratorLibraw1394();
+    DeviceIteratorLibraw1394(bool skipOpenDevices = true);
     ~DeviceIteratorLibraw1394();
   public:
     FirewireDevice* next();
+    DeviceProbe* nextProbe();
+    FirewireDevice* claim(DeviceProbe *probe);
+
+    /**
+     * Marks the node as unresponsive, so it gets skipped until the next bus reset
+     */
+    static void markUnresponsive(int port, nodeid_t node);
+
+    /**
+     * Forgets the cached number of ports, so it is read again (ie after a port got added or removed)
+     */
+    static void resetPorts();
   protected:
+    /**
+     * When true, devices which are in use already are skipped
+     */
+    bool skipOpenDevices;
+
     /**
      * Current port of this iterator
      */
@@ -61,10 +107,54 @@ namespace LibPhantom
      */
     raw1394_handle *handle;
 
+    /**
+     * Handles of all visited ports, which are used by the probes as well (so they are kept until the iterator is deleted)
+     */
+    std::vector<raw1394_handle *> handles;
+
+    /**
+     * Memory for the probes and their config ROM images
+     */
+    Arena arena;
+
+    /**
+     * Snapshot of the topology of the current port, taken when the port was opened
+     */
+    PortTopology topology;
+
+    /**
+     * Cached topologies, indexed by port
+     */
+    static std::vector<PortTopology> topologies;
+
+    /**
+     * Protects ports and topologies, which are shared by all iterators (and devices marking nodes unresponsive)
+     */
+    static std::mutex topologyMutex;
+
+    /**
+     * @return true when the node was marked unresponsive in the current generation of the port
+     */
+    static bool isUnresponsive(int port, nodeid_t node);
+
     /**
      * @return the number of available ports (cached)
      */
     int getPorts();
+
+    /**
+     * Opens a handle on the given port and updates the topology of the port when a bus reset occurred
+     *
+     * @throws some exception when no handle could be opened on the port
+     */
+    void openPort(int port);
+
+    /**
+     * Reads the self-ID packets of the topology map of the local node into topology
+     *
+     * @return false when the topology map could not be read
+     */
+    bool readTopology();
   };
 }
 
@@ -0,0 +1,140 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: identification of a device on the firewire bus
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "DeviceProbe.h"
+
+// Depending on which FW_METHOD is selected, add header file for static implementations
+#ifdef USE_libraw1394
+#include "libraw1394/csr.h"
+#endif
+#ifdef USE_macosx
+#define CSR_REGISTER_BASE  0xfffff0000000ULL
+#define CSR_CONFIG_ROM 0x400
+#endif
+
+#define CONFIG_ROM_ADDR    CSR_REGISTER_BASE + CSR_CONFIG_ROM
+
+using namespace LibPhantom;
+
+DeviceProbe::DeviceProbe(u_int32_t *configRomData) :
+  configRomRead(false), configRomValid(false), configRomData(configRomData), configRomLength(0)
+{
+}
+
+DeviceProbe::~DeviceProbe()
+{
+}
+
+unsigned int DeviceProbe::getVendorId()
+{
+
+  struct config_rom *crom = getConfigRom();
+  return crom == 0 ? 0 : crom->vendor_id;
+}
+
+char *DeviceProbe::getVendorName()
+{
+  struct config_rom *crom = getConfigRom();
+  return crom == 0 || crom->vendor[0] == 0 ? 0 : crom->vendor;
+}
+
+bool DeviceProbe::isSensableDevice()
+{
+  // Check if node has a SensAble device
+  if (getVendorId() != 0x000b99)
+    return false;
+
+  // Read vendor id from device memory as well
+  uint32_t vendor;
+  read(0x1006000c, (char *) &vendor, 4);
+  //TODO: ntoh
+  if (vendor != 0x00990b00)
+    return false;
+
+  return true;
+}
+
+struct config_rom* DeviceProbe::getConfigRom()
+{
+  if (!configRomRead)
+  {
+    configRomRead = true;
+    try
+    {
+      readConfigRom();
+    }
+    catch (...)
+    {
+      // Treat a device that fails to respond like a device without (valid) config ROM
+      configRomValid = false;
+      markUnresponsive();
+    }
+  }
+
+  if (!configRomValid)
+    return 0;
+
+  return &configRom;
+}
+
+void DeviceProbe::copyConfigRom(DeviceProbe *source)
+{
+  if (!source->configRomRead)
+  {
+    return;
+  }
+  configRomRead = true;
+  configRomValid = source->configRomValid;
+  configRom = source->configRom;
+  configRomLength = source->configRomLength;
+  memcpy(configRomData, source->configRomData, configRomLength * 4);
+}
+
+void DeviceProbe::markUnresponsive()
+{
+}
+
+void DeviceProbe::readConfigRom()
+{
+  unsigned int needed = 1;
+
+  // Only the header is known to be present, the decoder tells how much more is needed to decode the config ROM
+  configRomLength = 0;
+  while (needed > configRomLength)
+  {
+    // Fetch the missing part with a single block read
+    unsigned int missing = needed - configRomLength;
+    read(CONFIG_ROM_ADDR + configRomLength * 4, (char *) (configRomData + configRomLength), missing * 4);
+    configRomToHostOrder(configRomData + configRomLength, missing);
+    configRomLength = needed;
+
+    needed = decodeConfigRom(configRomData, configRomLength, &configRom);
+    if (needed == 0)
+    {
+      // Not a valid config ROM
+      return;
+    }
+  }
+  configRomValid = true;
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: identification of a device on the firewire bus
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include "ConfigRom.h"
+
+namespace LibPhantom
+{
+  /**
+   * Device found while iterating over the busses, which can only be used to identify the device (read its config ROM and
+   * device memory). Use DeviceIterator::claim() to get a FirewireDevice to actually communicate with the device.
+   */
+  class DeviceProbe
+  {
+  public:
+    virtual ~DeviceProbe();
+
+    /**
+     * Read data from current device at given address
+     */
+    virtual void read(u_int64_t address, char *buffer, unsigned int length) = 0;
+
+    /**
+     * @return the vendor id of the device
+     */
+    unsigned int getVendorId();
+
+    /**
+     * @return the name of the vendor if it is supplied in the ROM of the device, or 0 when an error occurred (ie the name is not available)
+     */
+    char *getVendorName();
+
+    /**
+     * @return true if the node is a SensAble device
+     */
+    bool isSensableDevice();
+
+    /**
+     * @return the config rom struct. Do not use directly, but use getters (eg getVendorId())
+     */
+    struct config_rom* getConfigRom();
+
+    /**
+     * Takes over the config ROM of the given device (if it was read already), so it does not need to be read again
+     */
+    void copyConfigRom(DeviceProbe *source);
+
+  protected:
+    /**
+     * @param configRomData buffer of CONFIG_ROM_QUADLETS quadlets to store the config ROM image in
+     */
+    DeviceProbe(u_int32_t *configRomData);
+
+    /**
+     * Called when the device did not respond while reading its config ROM (by default nothing happens)
+     */
+    virtual void markUnresponsive();
+
+    /**
+     * Reads the config ROM with as few block reads as possible and decodes it
+     */
+    void readConfigRom();
+    struct config_rom configRom;
+    bool configRomRead; //Did we try to read the config ROM?
+    bool configRomValid; //Did we successfully read the config ROM?
+
+    /**
+     * Config ROM image (in host byte order) and the number of quadlets read so far
+     */
+    u_int32_t *configRomData;
+    unsigned int configRomLength;
+  };
+}
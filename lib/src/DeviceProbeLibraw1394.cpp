@@ -0,0 +1,51 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: identification of a device on the firewire bus, libraw1394 implementation
+ */
+
+#include "DeviceProbeLibraw1394.h"
+#include "CommunicationLibraw1394.h"
+#include "DeviceIteratorLibraw1394.h"
+
+using namespace LibPhantom;
+
+DeviceProbeLibraw1394::DeviceProbeLibraw1394(raw1394_handle *handle, int port, nodeid_t node, u_int32_t *configRomData) :
+  DeviceProbe(configRomData), handle(handle), port(port), node(node)
+{
+}
+
+void DeviceProbeLibraw1394::read(u_int64_t address, char *buffer, unsigned int length)
+{
+  CommunicationLibraw1394::read(handle, node, address, buffer, length);
+}
+
+int DeviceProbeLibraw1394::getPort()
+{
+  return port;
+}
+
+nodeid_t DeviceProbeLibraw1394::getNode()
+{
+  return node;
+}
+
+void DeviceProbeLibraw1394::markUnresponsive()
+{
+  DeviceIteratorLibraw1394::markUnresponsive(port, node);
+}
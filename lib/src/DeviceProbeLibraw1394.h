@@ -0,0 +1,54 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: identification of a device on the firewire bus, libraw1394 implementation
+ */
+
+#pragma once
+
+#include "libraw1394/raw1394.h"
+
+#include "DeviceProbe.h"
+
+namespace LibPhantom
+{
+  /**
+   * Lightweight device used while iterating: it does not create handles of its own, but uses the handle of the iterator.
+   * It is only valid as long as the DeviceIteratorLibraw1394 which created it exists.
+   */
+  class DeviceProbeLibraw1394 : public DeviceProbe
+  {
+  public:
+    DeviceProbeLibraw1394(raw1394_handle *handle, int port, nodeid_t node, u_int32_t *configRomData);
+
+    void read(u_int64_t address, char *buffer, unsigned int length);
+
+    int getPort();
+    nodeid_t getNode();
+  protected:
+    void markUnresponsive();
+
+    /**
+     * Handle of the iterator (connected to port)
+     */
+    raw1394_handle *handle;
+
+    int port;
+    nodeid_t node;
+  };
+}
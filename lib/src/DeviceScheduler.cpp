@@ -0,0 +1,330 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: earliest deadline first scheduling of the isochronous iterations of several devices on a few threads
+ */
+
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <exception>
+
+#include "DeviceScheduler.h"
+#include "Log.h"
+#include "Phantom.h"
+#include "ServoThread.h"
+
+// Time between checks for the packets of the devices which are due but did not receive anything yet (in nanoseconds)
+#define POLL_INTERVAL    20000
+
+using namespace LibPhantom;
+
+static int64_t now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * (int64_t) 1000000000 + ts.tv_nsec;
+}
+
+static void sleepUntil(int64_t time)
+{
+  struct timespec ts;
+  ts.tv_sec = time / 1000000000;
+  ts.tv_nsec = time % 1000000000;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0);
+}
+
+DeviceScheduler::DeviceScheduler(unsigned int threads) :
+  threadCount(threads ? threads : 1), priority(80), lock(true), locked(false), stopping(false), error(0)
+{
+}
+
+DeviceScheduler::~DeviceScheduler()
+{
+  stop();
+  for (std::vector<Device *>::iterator it = devices.begin(); it != devices.end(); it++)
+  {
+    delete *it;
+  }
+}
+
+unsigned int DeviceScheduler::add(Phantom *phantom, double rate, PhantomCycleCallback callback, void *userdata)
+{
+  if (!threads.empty())
+  {
+    // TODO Create some library exception and throw that one
+    throw "Devices cannot be added while the scheduler is started";
+  }
+
+  if (!(rate > 0 && rate <= 1e9))
+  {
+    // TODO Create some library exception and throw that one
+    throw "The rate of a device must be positive (and at most one cycle per nanosecond)";
+  }
+
+  Device *device = new Device();
+  device->phantom = phantom;
+  device->period = llrint(1e9 / rate);
+  device->callback = callback;
+  device->userdata = userdata;
+  devices.push_back(device);
+  return devices.size() - 1;
+}
+
+void DeviceScheduler::setPriority(int priority)
+{
+  this->priority = priority;
+}
+
+void DeviceScheduler::setCpus(const std::vector<int> &cpus)
+{
+  this->cpus = cpus;
+}
+
+void DeviceScheduler::setLockMemory(bool lock)
+{
+  this->lock = lock;
+}
+
+void DeviceScheduler::start()
+{
+  if (!threads.empty())
+  {
+    // TODO Create some library exception and throw that one
+    throw "The scheduler is already started";
+  }
+
+  if (lock && !locked)
+  {
+    locked = ServoThread::lockMemory();
+  }
+
+  int64_t start = now();
+  for (std::vector<Device *>::iterator it = devices.begin(); it != devices.end(); it++)
+  {
+    Device *device = *it;
+    device->release = start;
+    device->sumSlack = 0;
+    device->cycles.store(0, std::memory_order_relaxed);
+    device->misses.store(0, std::memory_order_relaxed);
+    device->skipped.store(0, std::memory_order_relaxed);
+    device->slack.store(0, std::memory_order_relaxed);
+    device->minSlack.store(INFINITY, std::memory_order_relaxed);
+    device->meanSlack.store(0, std::memory_order_relaxed);
+  }
+
+  error.store(0, std::memory_order_relaxed);
+  stopping.store(false, std::memory_order_relaxed);
+  for (unsigned int i = 0; i < threadCount && i < devices.size(); i++)
+  {
+    threads.push_back(new std::thread(&DeviceScheduler::run, this, i));
+  }
+}
+
+void DeviceScheduler::stop()
+{
+  stopping.store(true, std::memory_order_relaxed);
+  for (std::vector<std::thread *>::iterator it = threads.begin(); it != threads.end(); it++)
+  {
+    (*it)->join();
+    delete *it;
+  }
+  threads.clear();
+}
+
+const char *DeviceScheduler::getError() const
+{
+  return error.load(std::memory_order_acquire);
+}
+
+void DeviceScheduler::getSlack(unsigned int index, PhantomSlackStatistics &statistics) const
+{
+  const Device *device = devices.at(index);
+
+  statistics.cycles = device->cycles.load(std::memory_order_relaxed);
+  statistics.misses = device->misses.load(std::memory_order_relaxed);
+  statistics.skipped = device->skipped.load(std::memory_order_relaxed);
+  statistics.slack = device->slack.load(std::memory_order_relaxed);
+  statistics.minSlack = device->minSlack.load(std::memory_order_relaxed);
+  statistics.meanSlack = device->meanSlack.load(std::memory_order_relaxed);
+}
+
+void DeviceScheduler::run(unsigned int thread)
+{
+  if (priority > 0)
+  {
+    ServoThread::setRealtime(priority);
+  }
+  if (!cpus.empty())
+  {
+    ServoThread::pinToCpu(cpus[thread % cpus.size()]);
+  }
+  ServoThread::prefaultStack();
+
+  // The devices of this thread, and space for the ready and received ones (so the loop does not allocate)
+  std::vector<Device *> own, ready, received;
+  for (unsigned int i = thread; i < devices.size(); i += threadCount)
+  {
+    own.push_back(devices[i]);
+  }
+  ready.resize(own.size());
+  received.resize(own.size());
+
+  try
+  {
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+      int64_t time = now();
+      int64_t wakeup = INT64_MAX;
+      unsigned int count = 0;
+
+      for (std::vector<Device *>::iterator it = own.begin(); it != own.end(); it++)
+      {
+        Device *device = *it;
+        if (device->release > time)
+        {
+          if (device->release < wakeup)
+          {
+            wakeup = device->release;
+          }
+          continue;
+        }
+
+        // Insert in order of deadline, there are only a few devices per thread
+        unsigned int i = count++;
+        for (; i > 0 && ready[i - 1]->release + ready[i - 1]->period > device->release + device->period; i--)
+        {
+          ready[i] = ready[i - 1];
+        }
+        ready[i] = device;
+      }
+
+      if (count)
+      {
+        cycle(&ready[0], count, &received[0]);
+      }
+      else
+      {
+        sleepUntil(wakeup);
+      }
+    }
+  }
+  catch (const char *e)
+  {
+    PHANTOM_LOG_ERROR("Scheduler thread %u stopped: %s", thread, e);
+    error.store(e, std::memory_order_release);
+  }
+  catch (const std::exception &e)
+  {
+    // The message of the exception does not outlive it, and the log only keeps pointers to strings
+    PHANTOM_LOG_ERROR("Scheduler thread %u stopped by a std::exception", thread);
+    error.store("Exception raised in a scheduler thread", std::memory_order_release);
+  }
+  catch (...)
+  {
+    PHANTOM_LOG_ERROR("Scheduler thread %u stopped by an unknown exception", thread);
+    error.store("Unknown exception raised in a scheduler thread", std::memory_order_release);
+  }
+}
+
+void DeviceScheduler::cycle(Device **ready, unsigned int count, Device **received)
+{
+  // Receive without blocking, so a device without packets does not hold up the others: the devices which received
+  // their packets (or reached their deadline without) finish their cycle, the others are checked again shortly after
+  while (count && !stopping.load(std::memory_order_relaxed))
+  {
+    unsigned int waiting = 0, done = 0, i;
+    int64_t wakeup = INT64_MAX;
+
+    // Both lists keep the order of the deadlines
+    for (i = 0; i < count; i++)
+    {
+      Device *device = ready[i];
+      int64_t deadline = device->release + device->period;
+      if (device->phantom->isoPoll() || now() >= deadline)
+      {
+        received[done++] = device;
+      }
+      else
+      {
+        ready[waiting++] = device;
+        if (deadline < wakeup)
+        {
+          wakeup = deadline;
+        }
+      }
+    }
+    count = waiting;
+
+    if (done)
+    {
+      finish(received, done);
+    }
+    else
+    {
+      sleepUntil(std::min(now() + POLL_INTERVAL, wakeup));
+    }
+  }
+}
+
+void DeviceScheduler::finish(Device **received, unsigned int count)
+{
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+  {
+    if (received[i]->callback)
+    {
+      received[i]->callback(received[i]->phantom, received[i]->userdata);
+    }
+  }
+  for (i = 0; i < count; i++)
+  {
+    Device *device = received[i];
+    device->phantom->isoPollTransmit();
+
+    int64_t done = now();
+    int64_t deadline = device->release + device->period;
+    double slack = (deadline - done) * 1e-9;
+    uint64_t cycles = device->cycles.load(std::memory_order_relaxed) + 1;
+
+    device->sumSlack += slack;
+    device->slack.store(slack, std::memory_order_relaxed);
+    device->meanSlack.store(device->sumSlack / cycles, std::memory_order_relaxed);
+    if (slack < device->minSlack.load(std::memory_order_relaxed))
+    {
+      device->minSlack.store(slack, std::memory_order_relaxed);
+    }
+    if (slack < 0)
+    {
+      device->misses.store(device->misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    device->cycles.store(cycles, std::memory_order_relaxed);
+
+    // An idle device is not due again until its idle interval passed
+    device->release = device->phantom->isIdle() ? device->release + llrint(device->phantom->getIdleInterval() * 1e9)
+        : deadline;
+    if (done - device->release >= device->period)
+    {
+      // More than a period behind, skip the missed cycles instead of running them back to back
+      int64_t missed = (done - device->release) / device->period;
+      device->release += missed * device->period;
+      device->skipped.store(device->skipped.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+    }
+  }
+}
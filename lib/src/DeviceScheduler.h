@@ -0,0 +1,150 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: earliest deadline first scheduling of the isochronous iterations of several devices on a few threads
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace LibPhantom
+{
+  class Phantom;
+
+  /**
+   * Called for every cycle of a device, between receiving its packets and transmitting its forces
+   */
+  typedef void (*PhantomCycleCallback)(Phantom *phantom, void *userdata);
+
+  /**
+   * How much time was left before the deadline of the cycles of a device (in seconds)
+   */
+  struct PhantomSlackStatistics
+  {
+    /**
+     * Number of cycles done, and the number which finished after their deadline
+     */
+    uint64_t cycles;
+    uint64_t misses;
+
+    /**
+     * Number of cycles skipped because the device was more than a period behind
+     */
+    uint64_t skipped;
+
+    /**
+     * Slack of the last cycle, the smallest slack and the mean slack
+     */
+    double slack;
+    double minSlack;
+    double meanSlack;
+  };
+
+  /**
+   * Runs the cycles of several (started) devices on one or more threads. Each device is assigned to one of the threads
+   * (round robin) and has its own rate, the deadline of a cycle is the start of the next one. A thread handles the
+   * devices whose cycle is due in order of their deadline (EDF): the devices are polled for packets (without blocking,
+   * see Phantom::isoPoll()), then the callbacks of the ones which received their packets are called, then these transmit.
+   * The devices still waiting for packets are polled again until their packets arrive or their deadline passes (then the
+   * cycle is finished without new packets). Idle devices (see Phantom::setIdlePolicy()) are due once per idle interval.
+   */
+  class DeviceScheduler
+  {
+  public:
+    /**
+     * @param threads number of threads to run the devices on
+     */
+    DeviceScheduler(unsigned int threads = 1);
+
+    /**
+     * Stops the threads, the devices are not stopped
+     */
+    ~DeviceScheduler();
+
+    /**
+     * Adds a device, only before start()
+     *
+     * @param rate cycles per second, must be positive
+     * @return index of the device, see getSlack()
+     */
+    unsigned int add(Phantom *phantom, double rate = 1000, PhantomCycleCallback callback = 0, void *userdata = 0);
+
+    /**
+     * Real-time settings of the threads, see ServoThread. Thread i runs on cpus[i % cpus.size()] (when not empty).
+     */
+    void setPriority(int priority);
+    void setCpus(const std::vector<int> &cpus);
+    void setLockMemory(bool lock);
+
+    void start();
+    void stop();
+
+    /**
+     * @return the error which stopped a thread (an exception of a device), or 0
+     */
+    const char *getError() const;
+
+    /**
+     * Copies the slack statistics of the device with the given index, this can be called from any thread
+     */
+    void getSlack(unsigned int index, PhantomSlackStatistics &statistics) const;
+
+  private:
+    struct Device
+    {
+      Phantom *phantom;
+      int64_t period;
+      PhantomCycleCallback callback;
+      void *userdata;
+
+      /**
+       * Start of the next cycle (in nanoseconds), its deadline is one period later. Only used by the thread.
+       */
+      int64_t release;
+      double sumSlack;
+
+      std::atomic<uint64_t> cycles, misses, skipped;
+      std::atomic<double> slack, minSlack, meanSlack;
+    };
+
+    unsigned int threadCount;
+    std::vector<Device *> devices;
+    std::vector<std::thread *> threads;
+    int priority;
+    std::vector<int> cpus;
+    bool lock;
+    bool locked;
+    std::atomic<bool> stopping;
+    std::atomic<const char *> error;
+
+    void run(unsigned int thread);
+    /**
+     * Runs the cycles of the ready devices (in order of their deadline), received is space for as many devices
+     */
+    void cycle(Device **ready, unsigned int count, Device **received);
+
+    /**
+     * Calls the callbacks of the devices which received their packets, transmits and updates the slack statistics
+     */
+    void finish(Device **received, unsigned int count);
+  };
+}
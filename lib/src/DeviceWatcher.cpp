@@ -0,0 +1,176 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: watches the firewire busses for added and removed devices
+ */
+
+#include <poll.h>
+#include <memory>
+
+#include "DeviceWatcher.h"
+#include "DeviceIterator.h"
+
+// Depending on which FW_METHOD is selected, add header file for static implementations
+#ifdef USE_libraw1394
+#include "DeviceWatcherLibraw1394.h"
+#endif
+
+using namespace LibPhantom;
+
+DeviceWatcher* DeviceWatcher::createInstance()
+{
+#ifdef USE_libraw1394
+  return new DeviceWatcherLibraw1394;
+#endif
+  // TODO Implement using IOServiceAddMatchingNotification() for Mac OS X
+  throw "DeviceWatcher is not available for the used FW_METHOD";
+}
+
+DeviceWatcher::DeviceWatcher()
+{
+}
+
+DeviceWatcher::~DeviceWatcher()
+{
+}
+
+void DeviceWatcher::subscribe(Callback callback, void *userdata)
+{
+  Subscription s;
+  s.callback = callback;
+  s.userdata = userdata;
+  subscriptions.push_back(s);
+
+  // Let the new subscriber know about the devices we know of already (unless it unsubscribes while doing so)
+  for (std::map<u_int64_t, WatchedDevice>::iterator it = devices.begin(); it != devices.end() && isSubscribed(callback, userdata); it++)
+  {
+    callback(DEVICE_ADDED, it->second, userdata);
+  }
+}
+
+void DeviceWatcher::unsubscribe(Callback callback, void *userdata)
+{
+  for (std::vector<Subscription>::iterator it = subscriptions.begin(); it != subscriptions.end(); it++)
+  {
+    if (it->callback == callback && it->userdata == userdata)
+    {
+      subscriptions.erase(it);
+      return;
+    }
+  }
+}
+
+void DeviceWatcher::waitForEvents(int timeout)
+{
+  struct pollfd pfd;
+  pfd.fd = getFd();
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, timeout) > 0)
+  {
+    process();
+  }
+}
+
+const std::map<u_int64_t, WatchedDevice>& DeviceWatcher::getDevices()
+{
+  return devices;
+}
+
+DeviceIterator* DeviceWatcher::createIterator()
+{
+  // Devices in use should be reported as well, otherwise claiming a device would look like it got removed
+  return DeviceIterator::createInstance(false);
+}
+
+void DeviceWatcher::rescan()
+{
+  std::map<u_int64_t, WatchedDevice> found;
+  DeviceProbe *probe;
+
+  std::unique_ptr<DeviceIterator> i(createIterator());
+  for (probe = i->nextProbe(); probe; probe = i->nextProbe())
+  {
+    struct config_rom *crom = probe->getConfigRom();
+    if (crom == 0)
+    {
+      continue;
+    }
+
+    // Chip id (the lower 40 bits of the EUI-64), composed explicitly since the guid union depends on the byte order
+    u_int64_t chip = ((u_int64_t) crom->guid_hi) << 32 | crom->guid_lo;
+    if (chip != 0)
+    {
+      WatchedDevice d;
+      d.guid = ((u_int64_t) crom->vendor_id) << 40 | chip;
+      d.vendor_id = crom->vendor_id;
+      d.model_id = crom->model_id;
+      try
+      {
+        d.sensable = probe->isSensableDevice();
+      }
+      catch (...)
+      {
+        d.sensable = false;
+      }
+      found[d.guid] = d;
+    }
+  }
+  i.reset();
+
+  std::map<u_int64_t, WatchedDevice>::iterator it;
+  for (it = devices.begin(); it != devices.end(); it++)
+  {
+    if (found.find(it->first) == found.end())
+    {
+      notify(DEVICE_REMOVED, it->second);
+    }
+  }
+  for (it = found.begin(); it != found.end(); it++)
+  {
+    if (devices.find(it->first) == devices.end())
+    {
+      notify(DEVICE_ADDED, it->second);
+    }
+  }
+  devices.swap(found);
+}
+
+bool DeviceWatcher::isSubscribed(Callback callback, void *userdata)
+{
+  for (std::vector<Subscription>::iterator it = subscriptions.begin(); it != subscriptions.end(); it++)
+  {
+    if (it->callback == callback && it->userdata == userdata)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DeviceWatcher::notify(DeviceWatcherEvent event, const WatchedDevice &device)
+{
+  // Callbacks may (un)subscribe, so iterate over a copy and skip the subscribers which got removed in the meantime
+  std::vector<Subscription> current(subscriptions);
+  for (std::vector<Subscription>::iterator it = current.begin(); it != current.end(); it++)
+  {
+    if (isSubscribed(it->callback, it->userdata))
+    {
+      it->callback(event, device, it->userdata);
+    }
+  }
+}
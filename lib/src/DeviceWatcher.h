@@ -0,0 +1,128 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: watches the firewire busses for added and removed devices
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <map>
+#include <vector>
+
+namespace LibPhantom
+{
+  class DeviceIterator;
+
+  /**
+   * Description of a device that is present on one of the busses
+   */
+  struct WatchedDevice
+  {
+    /**
+     * EUI-64 of the device (vendor id and chip id from the config ROM), which does not change on bus resets
+     */
+    u_int64_t guid;
+    u_int32_t vendor_id;
+    u_int32_t model_id;
+
+    /**
+     * True when the device is a SensAble device (see FirewireDevice::isSensableDevice())
+     */
+    bool sensable;
+  };
+
+  enum DeviceWatcherEvent
+  {
+    DEVICE_ADDED, DEVICE_REMOVED
+  };
+
+  /**
+   * Keeps track of the devices on the firewire busses. The set of devices is only rescanned when the busses changed (a bus
+   * reset occurred or a port got added or removed) and subscribers are notified of the differences only.
+   *
+   * Do not create an instance of this class directly, instead use createInstance() to create a new instance of this class,
+   * this function will return the correct underlying instance.
+   */
+  class DeviceWatcher
+  {
+  public:
+    typedef void (*Callback)(DeviceWatcherEvent event, const WatchedDevice &device, void *userdata);
+
+    static DeviceWatcher *createInstance();
+    virtual ~DeviceWatcher();
+
+    /**
+     * Calls callback for each added or removed device. Devices which are present already are reported as added.
+     * Callbacks are allowed to (un)subscribe, a subscriber removed during a notification is not called anymore.
+     */
+    void subscribe(Callback callback, void *userdata);
+    void unsubscribe(Callback callback, void *userdata);
+
+    /**
+     * @return a file descriptor that becomes readable when process() needs to be called
+     */
+    virtual int getFd() = 0;
+
+    /**
+     * Handles pending events (without blocking) and notifies the subscribers when the set of devices changed
+     */
+    virtual void process() = 0;
+
+    /**
+     * Waits at most timeout milliseconds (or forever when negative) for events and processes them
+     */
+    void waitForEvents(int timeout);
+
+    /**
+     * @return the devices which are currently present, indexed by guid
+     */
+    const std::map<u_int64_t, WatchedDevice>& getDevices();
+
+  protected:
+    struct Subscription
+    {
+      Callback callback;
+      void *userdata;
+    };
+
+    std::vector<Subscription> subscriptions;
+
+    /**
+     * Devices found by the last scan
+     */
+    std::map<u_int64_t, WatchedDevice> devices;
+
+    DeviceWatcher();
+
+    /**
+     * @return the iterator used by rescan() (which is owned by the caller)
+     */
+    virtual DeviceIterator* createIterator();
+
+    /**
+     * Iterates over all devices and notifies the subscribers about the differences with the previous scan. This is a
+     * full enumeration of all busses, the differences are found by comparing the guids with the previous scan.
+     */
+    void rescan();
+
+    bool isSubscribed(Callback callback, void *userdata);
+
+    void notify(DeviceWatcherEvent event, const WatchedDevice &device);
+  };
+}
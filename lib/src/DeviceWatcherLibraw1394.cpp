@@ -0,0 +1,187 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: watches the firewire busses for added and removed devices, libraw1394 implementation
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "DeviceWatcherLibraw1394.h"
+#include "DeviceIteratorLibraw1394.h"
+
+// Maximum number of epoll events handled in one process() call
+#define MAX_EVENTS 16
+
+using namespace LibPhantom;
+
+DeviceWatcherLibraw1394::DeviceWatcherLibraw1394() :
+  uevent_fd(-1), dirty(true)
+{
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd == -1)
+  {
+    // TODO Create some library exception and throw that one
+    throw "Failed to create epoll file descriptor";
+  }
+
+  // Listen to the kernel uevents, if this fails we only get notified about bus resets
+  uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (uevent_fd != -1)
+  {
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // Kernel uevents
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = 0;
+    if (bind(uevent_fd, (struct sockaddr *) &addr, sizeof(addr)) || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, uevent_fd, &ev))
+    {
+      close(uevent_fd);
+      uevent_fd = -1;
+    }
+  }
+
+  openPorts();
+  process();
+}
+
+DeviceWatcherLibraw1394::~DeviceWatcherLibraw1394()
+{
+  closePorts();
+  if (uevent_fd != -1)
+  {
+    close(uevent_fd);
+  }
+  close(epoll_fd);
+}
+
+int DeviceWatcherLibraw1394::getFd()
+{
+  return epoll_fd;
+}
+
+void DeviceWatcherLibraw1394::process()
+{
+  struct epoll_event events[MAX_EVENTS];
+  int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 0);
+  bool uevents = false;
+
+  // Handle the bus resets first: handling the uevents might recreate the handles of the other events
+  for (int i = 0; i < n; i++)
+  {
+    raw1394_handle *handle = (raw1394_handle *) events[i].data.ptr;
+    if (handle == 0)
+    {
+      uevents = true;
+    }
+    else
+    {
+      // Calls busResetHandler() when a bus reset occurred
+      raw1394_loop_iterate(handle);
+    }
+  }
+
+  if (uevents && readUevents())
+  {
+    // A port might have been added or removed, so recreate our handles
+    DeviceIteratorLibraw1394::resetPorts();
+    closePorts();
+    openPorts();
+    dirty = true;
+  }
+
+  if (dirty)
+  {
+    dirty = false;
+    rescan();
+  }
+}
+
+void DeviceWatcherLibraw1394::openPorts()
+{
+  raw1394handle_t h = raw1394_new_handle();
+  if (h == 0)
+  {
+    return;
+  }
+  int ports = raw1394_get_port_info(h, 0, 0);
+  raw1394_destroy_handle(h);
+
+  for (int port = 0; port < ports; port++)
+  {
+    h = raw1394_new_handle_on_port(port);
+    if (h == 0)
+    {
+      continue;
+    }
+    raw1394_set_userdata(h, this);
+    raw1394_set_bus_reset_handler(h, &busResetHandler);
+    raw1394_busreset_notify(h, RAW1394_NOTIFY_ON);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = h;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, raw1394_get_fd(h), &ev);
+    handles.push_back(h);
+  }
+}
+
+void DeviceWatcherLibraw1394::closePorts()
+{
+  for (std::vector<raw1394_handle *>::iterator it = handles.begin(); it != handles.end(); it++)
+  {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, raw1394_get_fd(*it), 0);
+    raw1394_destroy_handle(*it);
+  }
+  handles.clear();
+}
+
+bool DeviceWatcherLibraw1394::readUevents()
+{
+  char buffer[4096];
+  bool firewire = false;
+  ssize_t len;
+
+  // A uevent consists of "ACTION@DEVPATH" followed by "KEY=VALUE" strings, all '\0' terminated
+  while ((len = recv(uevent_fd, buffer, sizeof(buffer) - 1, 0)) > 0)
+  {
+    buffer[len] = 0;
+    for (char *s = buffer; s < buffer + len; s += strlen(s) + 1)
+    {
+      if (strcmp(s, "SUBSYSTEM=firewire") == 0)
+      {
+        firewire = true;
+      }
+    }
+  }
+  return firewire;
+}
+
+int DeviceWatcherLibraw1394::busResetHandler(raw1394handle_t handle, unsigned int generation)
+{
+  DeviceWatcherLibraw1394 *watcher = (DeviceWatcherLibraw1394 *) raw1394_get_userdata(handle);
+  raw1394_update_generation(handle, generation);
+  watcher->dirty = true;
+  return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: watches the firewire busses for added and removed devices, libraw1394 implementation
+ */
+
+#pragma once
+
+#include <vector>
+#include "libraw1394/raw1394.h"
+
+#include "DeviceWatcher.h"
+
+namespace LibPhantom
+{
+  /**
+   * Listens for bus resets on every port and (on Linux) for firewire uevents of the kernel, which are sent when a device
+   * or port gets added or removed.
+   *
+   * All file descriptors are combined in a single epoll file descriptor, which is returned by getFd().
+   */
+  class DeviceWatcherLibraw1394 : public DeviceWatcher
+  {
+  public:
+    DeviceWatcherLibraw1394();
+    ~DeviceWatcherLibraw1394();
+
+    int getFd();
+    void process();
+  protected:
+    /**
+     * Handles (one per port) which get notified about bus resets
+     */
+    std::vector<raw1394_handle *> handles;
+
+    /**
+     * epoll file descriptor which contains all other file descriptors
+     */
+    int epoll_fd;
+
+    /**
+     * Netlink socket to receive kernel uevents, or -1 when not available
+     */
+    int uevent_fd;
+
+    /**
+     * When true, the busses need to be rescanned
+     */
+    bool dirty;
+
+    /**
+     * (Re)creates the bus reset handles for all ports
+     */
+    void openPorts();
+    void closePorts();
+
+    /**
+     * Reads all pending uevents
+     *
+     * @return true if one of the uevents was about the firewire subsystem
+     */
+    bool readUevents();
+
+    static int busResetHandler(raw1394handle_t handle, unsigned int generation);
+  };
+}
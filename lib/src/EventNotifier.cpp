@@ -0,0 +1,95 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: file descriptor which becomes readable when new samples arrive, for external event loops
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "EventNotifier.h"
+
+using namespace LibPhantom;
+
+EventNotifier::EventNotifier() :
+  pending(false)
+{
+#ifdef __linux__
+  fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fds[0] < 0)
+  {
+    // TODO Create some library exception and throw that one
+    throw "Could not create an eventfd";
+  }
+#else
+  if (pipe(fds) != 0)
+  {
+    // TODO Create some library exception and throw that one
+    throw "Could not create a pipe";
+  }
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  }
+#endif
+}
+
+EventNotifier::~EventNotifier()
+{
+  close(fds[0]);
+  if (fds[1] != fds[0])
+  {
+    close(fds[1]);
+  }
+}
+
+int EventNotifier::getFd() const
+{
+  return fds[0];
+}
+
+void EventNotifier::signal()
+{
+  if (pending.load(std::memory_order_relaxed) || pending.exchange(true, std::memory_order_acq_rel))
+  {
+    return;
+  }
+
+  // An eventfd needs 8 bytes, a pipe only needs a single one
+  uint64_t one = 1;
+  ssize_t result = write(fds[1], &one, fds[1] == fds[0] ? sizeof(one) : 1);
+  (void) result;
+}
+
+void EventNotifier::clear()
+{
+  // Drain first and clear the flag afterwards: a signal() during the drain does not write (the flag is still set), but
+  // its sample is read by the consumer after this returns. Clearing the flag first would allow a signal() to write and
+  // set the flag again, after which the drain reads its write away and no signal() would ever write again.
+  uint64_t buffer[8];
+  while (read(fds[0], buffer, sizeof(buffer)) > 0)
+  {
+  }
+
+  pending.store(false, std::memory_order_seq_cst);
+}
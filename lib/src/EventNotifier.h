@@ -0,0 +1,74 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: file descriptor which becomes readable when new samples arrive, for external event loops
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace LibPhantom
+{
+  /**
+   * Wraps an eventfd (a pipe on platforms without eventfd) which can be added to an epoll/poll/libuv loop. The devices
+   * signal it when they receive new samples, one notifier can be shared by a group of devices.
+   *
+   * Signals are coalesced: only the first signal after clear() writes to the file descriptor, so the isochronous
+   * thread does at most one system call per wakeup of the consumer.
+   */
+  class EventNotifier
+  {
+  public:
+    /**
+     * @throws some exception if the file descriptor cannot be created
+     */
+    EventNotifier();
+    ~EventNotifier();
+
+    EventNotifier(const EventNotifier &) = delete;
+    EventNotifier &operator=(const EventNotifier &) = delete;
+
+    /**
+     * @return the (non-blocking) file descriptor to wait for, it is readable while a signal is pending
+     */
+    int getFd() const;
+
+    /**
+     * Makes the file descriptor readable, if it is not already. This can be called from any thread.
+     */
+    void signal();
+
+    /**
+     * Called by the consumer when it woke up, before it reads the new state: makes the file descriptor unreadable
+     * again, so the next signal() wakes it up again
+     */
+    void clear();
+
+  private:
+    /**
+     * Read and write end (the same file descriptor for an eventfd)
+     */
+    int fds[2];
+
+    /**
+     * True when signalled and not cleared yet
+     */
+    std::atomic<bool> pending;
+  };
+}
@@ -19,29 +19,15 @@
  * Phantom Library: Generic implementation of communication functionalities
  */
 
-#include <string.h>
 #include <stdlib.h>
-#include <netinet/in.h>
 
 #include "FirewireDevice.h"
 #include "Communication.h"
 
-// Depending on which FW_METHOD is selected, add header file for static implementations
-#ifdef USE_libraw1394
-#include "libraw1394/csr.h"
-#endif
-#ifdef USE_macosx
-#define CSR_REGISTER_BASE  0xfffff0000000ULL
-#define CSR_CONFIG_ROM 0x400
-#endif
-
-#define CONFIG_ROM_ADDR    CSR_REGISTER_BASE + CSR_CONFIG_ROM
-
 using namespace LibPhantom;
 
 FirewireDevice::FirewireDevice() :
-  com(NULL), //this is set by the platform-specific constructor
-      configRomRead(false), configRomValid(false)
+  DeviceProbe(configRomBuffer), com(NULL) //this is set by the platform-specific constructor
 {
 
 }
@@ -51,235 +37,49 @@ FirewireDevice::~FirewireDevice()
 
 }
 
-unsigned int FirewireDevice::getVendorId()
+unsigned int FirewireDevice::allocateChannel()
 {
-
-  struct config_rom *crom = getConfigRom();
-  return crom == 0 ? 0 : crom->vendor_id;
+  unsigned int channel = getFreeChannel();
+  claimChannel(channel);
+  return channel;
 }
 
-char *FirewireDevice::getVendorName()
+void FirewireDevice::allocateBandwidth(unsigned int units)
 {
-  struct config_rom *crom = getConfigRom();
-  return crom == 0 ? 0 : crom->vendor;
+  // Bandwidth is not managed by default
 }
 
-bool FirewireDevice::isSensableDevice()
+void FirewireDevice::releaseBandwidth(unsigned int units)
 {
-  // Check if node has a SensAble device
-  if (getVendorId() != 0x000b99)
-    return false;
-
-  // Read vendor id from device memory as well
-  uint32_t vendor;
-  read(0x1006000c, (char *) &vendor, 4);
-  //TODO: ntoh
-  if (vendor != 0x00990b00)
-    return false;
-
-  return true;
 }
 
-struct config_rom* FirewireDevice::getConfigRom()
+unsigned int FirewireDevice::getAvailableBandwidth()
 {
-  if (!configRomRead)
-  {
-    readConfigRom();
-    configRomRead = true;
-  }
-
-  if (!configRomValid)
-    return 0;
-
-  return &configRom;
+  // Bandwidth is not managed by default, so everything is available
+  return ISO_BANDWIDTH_UNITS_MAX;
 }
 
-void FirewireDevice::readConfigRom()
+u_int32_t FirewireDevice::getPort()
 {
-  unsigned int i;
-
-  u_int32_t quadlet;
-  u_int64_t addr = CONFIG_ROM_ADDR;
-
-  memset(&configRom, 0, sizeof(struct config_rom));
-
-  /* Read the length of the bus info block */
-  read(addr, (char *) &quadlet, 4);
-
-  quadlet = ntohl(quadlet);
-
-  /* If the length isn't 4 it means the node doesn't have a general ROM
-   * format and instead contains only a 24 bit vendor ID.
-   */
-  if (quadlet >> 24 != 4)
-  {
-    configRom.vendor_id = quadlet & 0x00ffffff;
-  }
-  else
-  {
-    unsigned int len, value;
-    u_int64_t unit_dir_addr = 0, textual_leaf_addr = 0;
-
-    /* First data quadlet of bus info block in config ROM */
-    addr += 4;
-    read(addr, (char *) &quadlet, 4);
-
-    // Should be a magic number (not interesting enough to store)
-    if (quadlet != 0x34393331)
-    {
-      //      fprintf(stderr,"node 0x%x: wrong config ROM magic number 0x%08x\n", node, quadlet);
-      return;
-    }
-
-    /* Second data quadlet of bus info block in config ROM */
-    addr += 4;
-    read(addr, (char *) &quadlet, 4);
-    quadlet = ntohl(quadlet);
-
-    configRom.irm_cap = quadlet >> 31;
-    configRom.cycle_master_cap = (quadlet >> 30) & 0x01;
-    configRom.iso_cap = (quadlet >> 29) & 0x01;
-    configRom.bus_manager_cap = (quadlet >> 28) & 0x01;
-    configRom.cycle_clk_accuracy = (quadlet >> 16) & 0xff;
-    configRom.max_async_bwrite_payload = 2 << ((quadlet >> 12) & 0x0f);
-    configRom.link_speed = quadlet & 7;
-
-    /* Third data quadlet of bus info block in config ROM */
-    addr += 4;
-    read(addr, (char *) &quadlet, 4);
-
-    quadlet = ntohl(quadlet);
-
-    configRom.vendor_id = quadlet >> 8;
-    configRom.guid_hi = quadlet & 0xff;
-
-    /* Forth data quadlet of bus info block in config ROM */
-    addr += 4;
-    read(addr, (char *) &quadlet, 4);
-
-    quadlet = ntohl(quadlet);
-
-    configRom.guid_lo = quadlet;
-
-    /* The next quadlet contains the length of the root directory in
-     * quadlets (32 bits).
-     */
-    addr += 4;
-    read(addr, (char *) &quadlet, 4);
-
-    quadlet = ntohl(quadlet);
-
-    len = quadlet >> 16;
-    if (len > 16)
-    {
-      //      fprintf(stderr,"node 0x%x: unexpected large root dir length %d set to 16\n", node, len);
-      len = 16;
-    }
-
-    /* Scan the root directory for entries of interest */
-    for (i = 0; i < len; i++)
-    {
-      addr += 4;
-      read(addr, (char *) &quadlet, 4);
-
-      quadlet = ntohl(quadlet);
-      /* These quadlets are key-value pairs; the key is in the upper 8 bits
-       * bits of the quadlet.
-       */
-      value = quadlet & 0x00ffffff;
-      switch (quadlet >> 24)
-      {
-      case 0x0c:
-        configRom.node_capabilities = value;
-        break;
-      case 0x03:
-        //             if(value != configRom.vendor_id)
-        //               fprintf(stderr,"node 0x%x: vendor ID mismatch: 0x%06x (bus info block) vs 0x%06x (root dir)\n", node, configRom.vendor_id, value);
-        break;
-      case 0xd1:
-        unit_dir_addr = addr + value * 4;
-        break;
-      case 0x8d:
-        /* addr + value * 4 is address of Node_unique_id leaf in
-         * config ROM.  Silently ignore this since we don't need
-         * it at present.
-         */
-        break;
-      case 0x81:
-        textual_leaf_addr = addr + value * 4;
-        break;
-        //           default: fprintf(stderr,"node 0x%x: unknown root dir key 0x%02x seen\n",node, quadlet >> 24);
-      }
-    }
-
-    /* Next come the unit directories. If there was an entry in the root
-     * directory indicating a unit directory was present, get its length and
-     * parse it.
-     */
-    if (unit_dir_addr > 0)
-    {
-      addr = unit_dir_addr;
-      read(addr, (char *) &quadlet, 4);
-
-      quadlet = ntohl(quadlet);
-      len = quadlet >> 16;
-      //      fprintf(stderr,"node 0x%x: unit directory length is %d quadlets\n",node,len);
-
-      for (i = 0; i < len; i++)
-      {
-        addr += 4;
-        read(addr, (char *) &quadlet, 4);
-        quadlet = ntohl(quadlet);
-        /* Also, the unit dir has key-value pairs */
-        value = quadlet & 0x00ffffff;
-        switch (quadlet >> 24)
-        {
-        case 0x12:
-          configRom.unit_spec_id = value;
-          break;
-        case 0x13:
-          configRom.unit_sw_version = value;
-          break;
-        case 0x17:
-          configRom.model_id = value;
-          break;
-        }
-      }
-    }
-
-    if (textual_leaf_addr > 0)
-    {
-      addr = textual_leaf_addr;
-      read(addr, (char *) &quadlet, 4);
-
-      quadlet = ntohl(quadlet);
-      len = quadlet >> 16;
-      //        fprintf(stderr,"node 0x%x: textual leaf length is %d quadlets\n",node,len);
-
-      // Unused?(always 0)
-      // Encoding for vendor text?
-      //        addr += 4;
-      //        if(read_config_rom_quadlet(handle,node,addr,&quadlet) < 0)
-      //          return 0;
-      //        printf("language_specifier_id %x\n", quadlet >> 8);
+  return 0;
+}
 
-      // Unused?(always 0)
-      // Encoding for vendor text?
-      //        addr += 4;
-      //        if(read_config_rom_quadlet(handle,node,addr,&quadlet) < 0)
-      //          return 0;
-      //        printf("language_id %x\n", quadlet);
+unsigned int FirewireDevice::getSpeed()
+{
+  struct config_rom *crom = getConfigRom();
+  return crom ? crom->link_speed : 0;
+}
 
-      len = (len - 2) * 4;
+unsigned int FirewireDevice::isoBandwidthUnits(unsigned int payload, unsigned int speed, unsigned int gapCount)
+{
+  // Isochronous packets have three header quadlets (header, header CRC and data CRC) and quadlet aligned data
+  unsigned int bytes = 12 + ((payload + 3) & ~3);
 
-      //TODO: fix this memory leak (if a device is deleted or if the next read fails)
-      configRom.vendor = new char[len];
+  // One allocation unit is the time to send a quadlet at S1600, which equals sending a byte at S400
+  unsigned int units = speed <= 2 ? bytes << (2 - speed) : (bytes + (1 << (speed - 2)) - 1) >> (speed - 2);
 
-      addr += 12; // 4 (length field) + 8 (Skip language_specifier_id and langude_id)
-      read(addr, configRom.vendor, len);
-    }
-  }
-  configRomValid = true;
+  // Arbitration overhead (same estimation as the Linux firewire stack uses)
+  return units + (gapCount < 63 ? gapCount * 97 / 10 + 89 : 512);
 }
 
 void FirewireDevice::read(u_int64_t address, char *buffer, unsigned int length)
@@ -23,44 +23,16 @@
 
 #include <sys/types.h>
 #include "Communication.h"
-#include "FirewireDevice.h"
+#include "DeviceProbe.h"
+
+// Isochronous bandwidth of a bus in allocation units (the initial value of the BANDWIDTH_AVAILABLE register)
+#define ISO_BANDWIDTH_UNITS_MAX    4915
 
 namespace LibPhantom
 {
-  //TODO Take a look at the fields and remove the ones which do not influence finding PHANTOM devices (ie vendor name)
-
-  struct config_rom
-  {
-    unsigned char motu_fw_audio :1;
-    unsigned char irm_cap :1;
-    unsigned char cycle_master_cap :1;
-    unsigned char iso_cap :1;
-    unsigned char bus_manager_cap :1;
-    unsigned char cycle_clk_accuracy;
-    unsigned int max_async_bwrite_payload;
-    unsigned int link_speed;
-    union
-    {
-      struct
-      {
-        u_int32_t guid_lo;
-        u_int32_t guid_hi;
-      };
-      u_int64_t guid;
-    };
-    u_int32_t node_capabilities;
-    u_int32_t vendor_id;
-    u_int32_t unit_spec_id;
-    u_int32_t unit_sw_version;
-    u_int32_t model_id;
-
-    char *vendor;
-
-  };
-
   class Communication;
 
-  class FirewireDevice
+  class FirewireDevice : public DeviceProbe
   {
   public:
     FirewireDevice();
@@ -89,41 +61,63 @@ namespace LibPhantom
     virtual void releaseChannel(unsigned int channel) = 0;
 
     /**
-     * Read data from current device at given address
+     * Finds and claims a free isochronous channel at once (so no other process can claim it in between)
+     *
+     * @return the claimed channel
+     * @throws some exception if not free channels are available
      */
-    void read(u_int64_t address, char *buffer, unsigned int length);
+    virtual unsigned int allocateChannel();
 
     /**
-     * Write data current device to given address
+     * Reserves isochronous bandwidth at the isochronous resource manager (see isoBandwidthUnits())
+     *
+     * @throws some exception if not enough bandwidth is available
      */
-    void write(u_int64_t address, char *buffer, unsigned int length);
+    virtual void allocateBandwidth(unsigned int units);
 
     /**
-     * @return the vendor id of the device
+     * Releases isochronous bandwidth which was reserved using allocateBandwidth()
      */
-    unsigned int getVendorId();
+    virtual void releaseBandwidth(unsigned int units);
 
     /**
-     * @return the name of the vendor if it is supplied in the ROM of the device, or 0 when an error occurred (ie the name is not available)
+     * @return the isochronous bandwidth (in allocation units) which is not reserved yet on the bus of this device
      */
-    char *getVendorName();
+    virtual unsigned int getAvailableBandwidth();
 
     /**
-     * @return true if the node is a SensAble device
+     * @return the port (bus) to which the device is connected, devices on different ports do not share bandwidth
      */
-    bool isSensableDevice();
+    virtual u_int32_t getPort();
 
     /**
-     * @return the config rom struct. Do not use directly, but use getters (eg getVendorId())
+     * @return speed code of the link of the device (see isoBandwidthUnits()), as given in its config ROM
      */
-    struct config_rom* getConfigRom();
+    unsigned int getSpeed();
+
+    /**
+     * @param payload maximum number of data bytes of the isochronous packets
+     * @param speed speed code of the packets: 0 (S100), 1 (S200), 2 (S400), 3 (S800), ...
+     * @param gapCount gap count of the bus, the default (maximum) one gives the worst case
+     * @return the number of bandwidth allocation units required to send a packet each cycle
+     */
+    static unsigned int isoBandwidthUnits(unsigned int payload, unsigned int speed, unsigned int gapCount = 63);
+
+    /**
+     * Read data from current device at given address
+     */
+    virtual void read(u_int64_t address, char *buffer, unsigned int length);
+
+    /**
+     * Write data current device to given address
+     */
+    void write(u_int64_t address, char *buffer, unsigned int length);
   protected:
     Communication *com;
 
-    void readConfigRom();
-    struct config_rom configRom;
-    bool configRomRead; //Did we try to read the config ROM?
-    bool configRomValid; //Did we successfully read the config ROM?
+    /**
+     * Storage for the config ROM image
+     */
+    u_int32_t configRomBuffer[CONFIG_ROM_QUADLETS];
   };
 }
-
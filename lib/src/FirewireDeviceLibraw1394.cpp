@@ -23,13 +23,30 @@
 #include <string.h>     // stderror
 #include <stdlib.h>     // NULL
 #include <errno.h>
+#include <poll.h>
+#include <unistd.h>     // usleep
 #include <netinet/in.h> // ntohl
 #include "libraw1394/csr.h"
+#include "libraw1394/ieee1394.h"
 
 #include "FirewireDeviceLibraw1394.h"
 #include "CommunicationLibraw1394.h"
+#include "DeviceIteratorLibraw1394.h"
 
 #define CHANNELS_AVAILABLE_ADDR    CSR_REGISTER_BASE + CSR_CHANNELS_AVAILABLE_HI
+#define BANDWIDTH_AVAILABLE_ADDR   CSR_REGISTER_BASE + CSR_BANDWIDTH_AVAILABLE
+
+// Number of compare-swap attempts before giving up when other nodes keep changing the same register
+#define MAX_LOCK_ATTEMPTS          16
+
+// Number of times a lock transaction is retried while the IRM is busy (EAGAIN)
+#define MAX_BUSY_RETRIES           100
+
+// Delay (in microseconds) before the first retry of a busy lock transaction, increased linearly with every retry
+#define BUSY_BACKOFF_US            100
+
+// Bit of the channel in its CHANNELS_AVAILABLE quadlet (HI contains channels 0-31, LO channels 32-63)
+#define CHANNEL_BIT(channel)       (1U << (31 - ((channel) & 31)))
 
 // Returns true of false depending whether the 'channel bit' is set in channels
 #define CHANNEL_IS_FREE(channels, channel) (channels & (1L<<(63 - channel)))
@@ -40,6 +57,45 @@ unsigned int FirewireDeviceLibraw1394::number_of_open_devices = 0;
 unsigned int FirewireDeviceLibraw1394::max_open_devices = 2;
 FirewireDeviceLibraw1394** FirewireDeviceLibraw1394::open_devices = (FirewireDeviceLibraw1394**) malloc(
     sizeof(FirewireDeviceLibraw1394**) * FirewireDeviceLibraw1394::max_open_devices);
+std::vector<FirewireDeviceLibraw1394::IrmRegisters> FirewireDeviceLibraw1394::irm_registers;
+std::mutex FirewireDeviceLibraw1394::irmMutex;
+
+// Modify functions for lockModify(), arg points to the channel bit or the number of bandwidth units
+static bool allocateFirstChannel(quadlet_t old, quadlet_t *value, void *arg)
+{
+  if (old == 0)
+  {
+    return false;
+  }
+  // Channels are numbered from the most significant bit
+  *(unsigned int *) arg = __builtin_clz(old);
+  *value = old & ~(0x80000000U >> __builtin_clz(old));
+  return true;
+}
+
+static bool clearBit(quadlet_t old, quadlet_t *value, void *arg)
+{
+  *value = old & ~*(quadlet_t *) arg;
+  return (old & *(quadlet_t *) arg) != 0;
+}
+
+static bool setBit(quadlet_t old, quadlet_t *value, void *arg)
+{
+  *value = old | *(quadlet_t *) arg;
+  return (old & *(quadlet_t *) arg) == 0;
+}
+
+static bool subtractUnits(quadlet_t old, quadlet_t *value, void *arg)
+{
+  *value = old - *(unsigned int *) arg;
+  return old >= *(unsigned int *) arg;
+}
+
+static bool addUnits(quadlet_t old, quadlet_t *value, void *arg)
+{
+  *value = old + *(unsigned int *) arg;
+  return *value <= ISO_BANDWIDTH_UNITS_MAX;
+}
 
 FirewireDeviceLibraw1394::FirewireDeviceLibraw1394(u_int32_t port, nodeid_t node) :
   port(port), node(node)
@@ -58,7 +114,7 @@ FirewireDeviceLibraw1394::FirewireDeviceLibraw1394(u_int32_t port, nodeid_t node
   handle = raw1394_new_handle_on_port(port);
   // TODO throw error if failed
 
-  // TODO on busreset the irm node needs to be updated!
+  // Updated by updateGeneration() after a bus reset
   irm_node = raw1394_get_irm_id(handle);
 }
 
@@ -91,6 +147,11 @@ bool FirewireDeviceLibraw1394::deviceIsOpen(u_int32_t port, nodeid_t node)
   return false;
 }
 
+void FirewireDeviceLibraw1394::markUnresponsive()
+{
+  DeviceIteratorLibraw1394::markUnresponsive(port, node);
+}
+
 unsigned int FirewireDeviceLibraw1394::getFreeChannel()
 {
   int i;
@@ -104,6 +165,12 @@ unsigned int FirewireDeviceLibraw1394::getFreeChannel()
     channelsq[i] = ntohl(channelsq[i]);
   }
   channels = ((octlet_t) channelsq[0]) << 32 | channelsq[1]; // swap quadlets
+  {
+    std::lock_guard<std::mutex> lock(irmMutex);
+    IrmRegisters *irm = getIrmRegisters();
+    irm->channels[0] = channelsq[0];
+    irm->channels[1] = channelsq[1];
+  }
 
   for (i = 0; i < 64; i++)
   {
@@ -119,7 +186,10 @@ unsigned int FirewireDeviceLibraw1394::getFreeChannel()
 
 void FirewireDeviceLibraw1394::claimChannel(unsigned int channel)
 {
-  if (raw1394_channel_modify(handle, channel, RAW1394_MODIFY_ALLOC))
+  quadlet_t bit = CHANNEL_BIT(channel);
+  std::lock_guard<std::mutex> lock(irmMutex);
+  if (channel >= 64 || !lockModify(CHANNELS_AVAILABLE_ADDR + (channel / 32) * 4,
+      &getIrmRegisters()->channels[channel / 32], clearBit, &bit))
   {
     throw "Failed to claim channel";
   }
@@ -127,10 +197,150 @@ void FirewireDeviceLibraw1394::claimChannel(unsigned int channel)
 
 void FirewireDeviceLibraw1394::releaseChannel(unsigned int channel)
 {
-  if (raw1394_channel_modify(handle, channel, RAW1394_MODIFY_FREE))
+  quadlet_t bit = CHANNEL_BIT(channel);
+  std::lock_guard<std::mutex> lock(irmMutex);
+  if (channel >= 64 || !lockModify(CHANNELS_AVAILABLE_ADDR + (channel / 32) * 4,
+      &getIrmRegisters()->channels[channel / 32], setBit, &bit))
   {
-    throw "Failed to claim channel";
+    throw "Failed to release channel";
+  }
+}
+
+unsigned int FirewireDeviceLibraw1394::allocateChannel()
+{
+  std::lock_guard<std::mutex> lock(irmMutex);
+  IrmRegisters *irm = getIrmRegisters();
+  unsigned int channel;
+
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    if (lockModify(CHANNELS_AVAILABLE_ADDR + i * 4, &irm->channels[i], allocateFirstChannel, &channel))
+    {
+      return i * 32 + channel;
+    }
+  }
+
+  // TODO Create some library exception and throw that one
+  throw "No free isochronous channels available";
+}
+
+void FirewireDeviceLibraw1394::allocateBandwidth(unsigned int units)
+{
+  std::lock_guard<std::mutex> lock(irmMutex);
+  if (!lockModify(BANDWIDTH_AVAILABLE_ADDR, &getIrmRegisters()->bandwidth, subtractUnits, &units))
+  {
+    // TODO Create some library exception and throw that one
+    throw "Not enough isochronous bandwidth available";
+  }
+}
+
+void FirewireDeviceLibraw1394::releaseBandwidth(unsigned int units)
+{
+  std::lock_guard<std::mutex> lock(irmMutex);
+  if (!lockModify(BANDWIDTH_AVAILABLE_ADDR, &getIrmRegisters()->bandwidth, addUnits, &units))
+  {
+    throw "Failed to release isochronous bandwidth";
+  }
+}
+
+bool FirewireDeviceLibraw1394::lockModify(u_int64_t address, quadlet_t *cached, bool(*modify)(quadlet_t old,
+    quadlet_t *value, void *arg), void *arg)
+{
+  quadlet_t old = *cached, value, result;
+  bool refreshed = false;
+
+  for (unsigned int attempt = 0; attempt < MAX_LOCK_ATTEMPTS; attempt++)
+  {
+    if (!modify(old, &value, arg))
+    {
+      if (refreshed)
+      {
+        return false;
+      }
+      // The cached value might be outdated, so read the actual value before giving up
+      ((CommunicationLibraw1394 *) com)->read(irm_node, address, (char *) &result, 4);
+      old = ntohl(result);
+      refreshed = true;
+      continue;
+    }
+
+    unsigned int busy = 0;
+    while (raw1394_lock(handle, irm_node, address, EXTCODE_COMPARE_SWAP, htonl(value), htonl(old), &result))
+    {
+      if (errno != EAGAIN)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Lock transaction with the isochronous resource manager failed";
+      }
+      if (++busy >= MAX_BUSY_RETRIES)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Isochronous resource manager stayed busy";
+      }
+      // The transaction may have failed because of a bus reset, after which the IRM can be another node
+      updateGeneration();
+      usleep(busy * BUSY_BACKOFF_US);
+    }
+
+    if (ntohl(result) == old)
+    {
+      // Succeeded, so we know the actual value now
+      *cached = value;
+      return true;
+    }
+
+    // Someone else changed the register (or our cached value was outdated), retry with the actual value
+    old = ntohl(result);
+    refreshed = true;
+  }
+
+  // TODO Create some library exception and throw that one
+  throw "Too much contention on the isochronous resource manager";
+}
+
+unsigned int FirewireDeviceLibraw1394::getAvailableBandwidth()
+{
+  quadlet_t bandwidth;
+
+  ((CommunicationLibraw1394 *) com)->read(irm_node, BANDWIDTH_AVAILABLE_ADDR, (char *) &bandwidth, 4);
+  std::lock_guard<std::mutex> lock(irmMutex);
+  getIrmRegisters()->bandwidth = ntohl(bandwidth);
+  return ntohl(bandwidth);
+}
+
+void FirewireDeviceLibraw1394::updateGeneration()
+{
+  // A bus reset is reported as an event on the handle, the default bus reset handler updates the generation of the
+  // handle (raw1394_update_generation()). Only process pending events, so this never blocks.
+  struct pollfd fd;
+  fd.fd = raw1394_get_fd(handle);
+  fd.events = POLLIN;
+  if (::poll(&fd, 1, 0) == 1)
+  {
+    raw1394_loop_iterate(handle);
+  }
+  irm_node = raw1394_get_irm_id(handle);
+}
+
+FirewireDeviceLibraw1394::IrmRegisters *FirewireDeviceLibraw1394::getIrmRegisters()
+{
+  unsigned int generation = raw1394_get_generation(handle);
+  if (irm_registers.size() <= port)
+  {
+    irm_registers.resize(port + 1);
+  }
+
+  IrmRegisters *irm = &irm_registers[port];
+  if (!irm->valid || irm->generation != generation)
+  {
+    // Assume nothing is allocated (the IRM registers are reset by a bus reset), the first lock transaction corrects this
+    // when needed
+    irm->channels[0] = irm->channels[1] = 0xffffffff;
+    irm->bandwidth = ISO_BANDWIDTH_UNITS_MAX;
+    irm->valid = true;
+    irm->generation = generation;
   }
+  return irm;
 }
 
 u_int32_t FirewireDeviceLibraw1394::getPort()
@@ -22,6 +22,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <mutex>
+#include <vector>
 #include "libraw1394/raw1394.h"
 
 #include "FirewireDevice.h"
@@ -39,6 +41,10 @@ namespace LibPhantom
     unsigned int getFreeChannel();
     void claimChannel(unsigned int channel);
     void releaseChannel(unsigned int channel);
+    unsigned int allocateChannel();
+    void allocateBandwidth(unsigned int units);
+    void releaseBandwidth(unsigned int units);
+    unsigned int getAvailableBandwidth();
 
     /**
      * Returns the port to which the device is connected to
@@ -55,6 +61,8 @@ namespace LibPhantom
      */
     static bool deviceIsOpen(u_int32_t port, nodeid_t node);
   protected:
+    void markUnresponsive();
+
     /**
      * Handle connected to the port given at the constructor
      */
@@ -68,6 +76,64 @@ namespace LibPhantom
      */
     nodeid_t irm_node;
 
+    /**
+     * Last known values (host byte order) of the registers of the isochronous resource manager of a port. The values are
+     * used as expected values for compare-swap lock transactions, so an allocation only takes a single transaction when
+     * the values are correct. When they are not, the lock transaction returns the correct value.
+     */
+    struct IrmRegisters
+    {
+      quadlet_t channels[2];
+      quadlet_t bandwidth;
+
+      /**
+       * When false, the values were not initialised yet
+       */
+      bool valid;
+
+      /**
+       * Bus generation of the values, after a bus reset the resources are allocated again from scratch
+       */
+      unsigned int generation;
+    };
+
+    /**
+     * Cached registers, indexed by port
+     */
+    static std::vector<IrmRegisters> irm_registers;
+
+    /**
+     * Protects irm_registers, which are shared by all devices (possibly used from different threads). Held during the
+     * lock transactions, so the cached values stay consistent with the registers.
+     */
+    static std::mutex irmMutex;
+
+    /**
+     * Changes the value of an IRM register using compare-swap lock transactions (retrying when another node changed the
+     * register in between)
+     *
+     * @param cached last known value of the register, is updated with the new value
+     * @param modify calculates the new value from the old value, returns false when this is not possible (ie the channel is
+     *        not free)
+     * @return false when modify failed on the actual value of the register
+     * @throws some exception when the lock transaction failed or the IRM stayed busy (or contended) for too long
+     *
+     * The caller must hold irmMutex.
+     */
+    bool lockModify(u_int64_t address, quadlet_t *cached, bool(*modify)(quadlet_t old, quadlet_t *value, void *arg),
+        void *arg);
+
+    /**
+     * @return the cached IRM registers for the port of this device, reset to their initial values when a bus reset occurred
+     *         since they were cached. The caller must hold irmMutex, the pointer is only valid while it does.
+     */
+    IrmRegisters *getIrmRegisters();
+
+    /**
+     * Updates the generation of the handle and irm_node after a bus reset
+     */
+    void updateGeneration();
+
     static unsigned int max_open_devices;
     static unsigned int number_of_open_devices;
     static FirewireDeviceLibraw1394** open_devices;
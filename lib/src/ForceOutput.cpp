@@ -0,0 +1,174 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: forces set by the application, and what to transmit when the application is late
+ */
+
+#include <math.h>
+#include <time.h>
+
+#include "ForceOutput.h"
+#include "PhantomPacket.h"
+
+using namespace LibPhantom;
+using namespace PhantomPacketLayout;
+
+static uint16_t rawForce(double force)
+{
+  double raw = FORCE_NONE + force;
+  return raw < 0 ? 0 : raw > FORCE_MAX ? FORCE_MAX : (uint16_t) lrint(raw);
+}
+
+ForceOutput::ForceOutput() :
+  policy(HOLD), deadline(0.002), horizon(0.01), misses(0), missPeriods(0), missTime(0), longestMiss(0), missStart(-1)
+{
+  last.time = -1;
+  last.motorsOn = false;
+  for (unsigned int axis = 0; axis < 3; axis++)
+  {
+    last.force[axis] = 0;
+  }
+}
+
+void ForceOutput::setStalePolicy(StalePolicy policy, double deadline, double horizon)
+{
+  this->policy.store(policy, std::memory_order_relaxed);
+  this->deadline.store(deadline, std::memory_order_relaxed);
+  this->horizon.store(horizon, std::memory_order_relaxed);
+}
+
+void ForceOutput::set(const int16_t force[3], bool motorsOn, double time)
+{
+  Command command;
+
+  command.time = time < 0 ? now() : time;
+  command.motorsOn = motorsOn;
+  // The previous forces are only useful for extrapolating when the motors were on already
+  command.previousTime = last.motorsOn ? last.time : -1;
+  for (unsigned int axis = 0; axis < 3; axis++)
+  {
+    command.force[axis] = force[axis];
+    command.previous[axis] = last.force[axis];
+  }
+
+  commands.write(command);
+  last = command;
+}
+
+uint16_t ForceOutput::evaluate(double time, uint16_t force[3])
+{
+  Command command;
+  double limit = deadline.load(std::memory_order_relaxed);
+
+  if (!commands.read(command) || !command.motorsOn)
+  {
+    force[0] = force[1] = force[2] = FORCE_NONE;
+    return STATUS_DEFAULT;
+  }
+
+  double age = time - command.time;
+  if (age <= limit)
+  {
+    if (missStart >= 0)
+    {
+      // The application caught up again
+      double duration = time - missStart;
+      missTime.store(missTime.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+      if (duration > longestMiss.load(std::memory_order_relaxed))
+      {
+        longestMiss.store(duration, std::memory_order_relaxed);
+      }
+      missStart = -1;
+    }
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+      force[axis] = rawForce(command.force[axis]);
+    }
+    return STATUS_DEFAULT | STATUS_MOTORS_ON;
+  }
+
+  misses.store(misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (missStart < 0)
+  {
+    missStart = command.time + limit;
+    missPeriods.store(missPeriods.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  double late = age - limit;
+  switch (policy.load(std::memory_order_relaxed))
+  {
+    case EXTRAPOLATE:
+      if (command.previousTime >= 0 && command.previousTime < command.time)
+      {
+        double t = fmin(age, limit + horizon.load(std::memory_order_relaxed)) / (command.time - command.previousTime);
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+          force[axis] = rawForce(command.force[axis] + (command.force[axis] - command.previous[axis]) * t);
+        }
+        break;
+      }
+      // Nothing to extrapolate from, so hold
+      [[fallthrough]];
+    case HOLD:
+      for (unsigned int axis = 0; axis < 3; axis++)
+      {
+        force[axis] = rawForce(command.force[axis]);
+      }
+      break;
+    case DECAY:
+    {
+      double factor = exp(-late / horizon.load(std::memory_order_relaxed));
+      for (unsigned int axis = 0; axis < 3; axis++)
+      {
+        force[axis] = rawForce(command.force[axis] * factor);
+      }
+      break;
+    }
+    default:
+      force[0] = force[1] = force[2] = FORCE_NONE;
+      return STATUS_DEFAULT;
+  }
+  return STATUS_DEFAULT | STATUS_MOTORS_ON;
+}
+
+bool ForceOutput::isIdle() const
+{
+  Command command;
+
+  if (!commands.read(command) || !command.motorsOn)
+  {
+    return true;
+  }
+  return command.force[0] == 0 && command.force[1] == 0 && command.force[2] == 0;
+}
+
+void ForceOutput::getStatistics(PhantomForceStatistics &statistics) const
+{
+  statistics.misses = misses.load(std::memory_order_relaxed);
+  statistics.missPeriods = missPeriods.load(std::memory_order_relaxed);
+  statistics.missTime = missTime.load(std::memory_order_relaxed);
+  statistics.longestMiss = longestMiss.load(std::memory_order_relaxed);
+}
+
+double ForceOutput::now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
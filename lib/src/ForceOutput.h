@@ -0,0 +1,148 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: forces set by the application, and what to transmit when the application is late
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "StateBuffer.h"
+
+namespace LibPhantom
+{
+  /**
+   * Counters of the transmitted forces
+   */
+  struct PhantomForceStatistics
+  {
+    /**
+     * Number of packets transmitted with forces older than the deadline (ie the stale policy was applied)
+     */
+    uint64_t misses;
+
+    /**
+     * Number of times the application missed the deadline (a series of consecutive misses counts once), their total
+     * duration and the longest one (in seconds, only finished ones are counted)
+     */
+    uint64_t missPeriods;
+    double missTime;
+    double longestMiss;
+  };
+
+  /**
+   * Forces set by the application thread and read (wait-free) by the thread transmitting the packets. When the
+   * application does not set new forces in time, the stale policy determines what is transmitted instead.
+   */
+  class ForceOutput
+  {
+  public:
+    enum StalePolicy
+    {
+      /**
+       * Repeat the last forces
+       */
+      HOLD,
+
+      /**
+       * Extrapolate the last two forces linearly (for at most the horizon, after that the forces are held)
+       */
+      EXTRAPOLATE,
+
+      /**
+       * Let the forces decay exponentially to zero (the horizon is the time constant)
+       */
+      DECAY,
+
+      /**
+       * Turn the motors off
+       */
+      MOTORS_OFF
+    };
+
+    ForceOutput();
+
+    /**
+     * @param deadline age (in seconds) after which forces are stale
+     * @param horizon seconds to extrapolate (EXTRAPOLATE) or the time constant (DECAY)
+     */
+    void setStalePolicy(StalePolicy policy, double deadline = 0.002, double horizon = 0.01);
+
+    /**
+     * Sets new forces, may only be called by a single thread at a time
+     *
+     * @param force force of the x, y and z axis, relative to no force (PhantomPacketLayout::FORCE_NONE)
+     * @param motorsOn when false the motors are turned off (and the stale policy is not used)
+     * @param time time (in seconds, see now()) for which the forces are computed, by default the current time
+     */
+    void set(const int16_t force[3], bool motorsOn = true, double time = -1);
+
+    /**
+     * Determines the forces to transmit in constant time, may only be called by a single thread at a time
+     *
+     * @param time current time (in seconds, see now())
+     * @param force is filled with the raw forces for the packet
+     * @return the status bits for the packet
+     */
+    uint16_t evaluate(double time, uint16_t force[3]);
+
+    /**
+     * @return true if no forces are commanded: nothing is set yet, the motors are turned off or all forces are 0
+     */
+    bool isIdle() const;
+
+    void getStatistics(PhantomForceStatistics &statistics) const;
+
+    /**
+     * @return the time (CLOCK_MONOTONIC) in seconds
+     */
+    static double now();
+
+  private:
+    struct Command
+    {
+      int16_t force[3];
+      int16_t previous[3];
+      double time;
+      double previousTime;
+      bool motorsOn;
+    };
+
+    StateBuffer<Command> commands;
+
+    /**
+     * Last command set, only used by the setting thread
+     */
+    Command last;
+
+    std::atomic<int> policy;
+    std::atomic<double> deadline, horizon;
+
+    /**
+     * Counters, only written by the evaluating thread
+     */
+    std::atomic<uint64_t> misses, missPeriods;
+    std::atomic<double> missTime, longestMiss;
+
+    /**
+     * Start of the current miss period, or a negative value when the forces are not stale
+     */
+    double missStart;
+  };
+}
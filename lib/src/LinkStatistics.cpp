@@ -0,0 +1,91 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: statistics of the isochronous link with a device, based on the message counters of the packets
+ */
+
+#include <time.h>
+
+#include "LinkStatistics.h"
+
+using namespace LibPhantom;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+LinkStatistics::LinkStatistics()
+{
+  reset();
+}
+
+void LinkStatistics::reset()
+{
+  packets = lost = gaps = duplicates = reordered = resyncs = restarts = dropped = transmitDropped = 0;
+  lastCount0 = 0;
+  lastCount1 = 0;
+  expected = 0;
+  synced = false;
+  samples = 0;
+  rate = 0;
+  rateTime = 0;
+}
+
+void LinkStatistics::sample(uint64_t packets)
+{
+  double time = now();
+  unsigned int index = samples % LINK_STATISTICS_SAMPLES;
+  // Once the ring wrapped, the oldest sample is the one after the slot that gets overwritten now
+  unsigned int oldest = samples < LINK_STATISTICS_SAMPLES ? 0 : (index + 1) % LINK_STATISTICS_SAMPLES;
+
+  sampleTime[index] = time;
+  samplePackets[index] = packets;
+  samples++;
+
+  // Find the oldest sample of the last second
+  while (oldest != index && time - sampleTime[oldest] > 1.0)
+  {
+    oldest = (oldest + 1) % LINK_STATISTICS_SAMPLES;
+  }
+  if (oldest != index)
+  {
+    rate.store((packets - samplePackets[oldest]) / (time - sampleTime[oldest]), std::memory_order_relaxed);
+  }
+  rateTime.store(time, std::memory_order_relaxed);
+}
+
+void LinkStatistics::get(PhantomLinkStatistics &statistics) const
+{
+  statistics.packets = packets.load(std::memory_order_relaxed);
+  statistics.lost = lost.load(std::memory_order_relaxed);
+  statistics.gaps = gaps.load(std::memory_order_relaxed);
+  statistics.duplicates = duplicates.load(std::memory_order_relaxed);
+  statistics.reordered = reordered.load(std::memory_order_relaxed);
+  statistics.resyncs = resyncs.load(std::memory_order_relaxed);
+  statistics.restarts = restarts.load(std::memory_order_relaxed);
+  statistics.dropped = dropped.load(std::memory_order_relaxed);
+  statistics.transmitDropped = transmitDropped.load(std::memory_order_relaxed);
+  statistics.count0 = lastCount0.load(std::memory_order_relaxed);
+  statistics.count1 = lastCount1.load(std::memory_order_relaxed);
+
+  // The rate is only updated when packets arrive, so it is outdated when nothing arrived for a while
+  statistics.rate = now() - rateTime.load(std::memory_order_relaxed) > 1.0 ? 0 : rate.load(std::memory_order_relaxed);
+}
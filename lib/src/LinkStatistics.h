@@ -0,0 +1,216 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: statistics of the isochronous link with a device, based on the message counters of the packets
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Gaps or reordering of more packets than this are considered a loss of synchronisation (ie the device restarted)
+#define LINK_STATISTICS_MAX_JUMP   1000
+
+// The time is sampled every this many packets to determine the rate (a power of 2)
+#define LINK_STATISTICS_SAMPLE     16
+
+// Number of samples kept, the rate is determined over the samples of the last second
+#define LINK_STATISTICS_SAMPLES    128
+
+namespace LibPhantom
+{
+  /**
+   * Counters of the isochronous link with a device
+   */
+  struct PhantomLinkStatistics
+  {
+    /**
+     * Number of packets received
+     */
+    uint64_t packets;
+
+    /**
+     * Number of packets missing according to the message counter (count0), and the number of gaps they were lost in
+     */
+    uint64_t lost;
+    uint64_t gaps;
+
+    /**
+     * Number of packets with the same message counter as the previous packet
+     */
+    uint64_t duplicates;
+
+    /**
+     * Number of packets with a message counter lower than expected (received after a later packet)
+     */
+    uint64_t reordered;
+
+    /**
+     * Number of times the message counter jumped more than LINK_STATISTICS_MAX_JUMP, the counter is followed again from
+     * there. Restarts are the jumps where count1 went back as well (ie the device restarted).
+     */
+    uint64_t resyncs;
+    uint64_t restarts;
+
+    /**
+     * Number of packets dropped by the driver (ie because the buffer was full) on the receive and transmit channel
+     */
+    uint64_t dropped;
+    uint64_t transmitDropped;
+
+    /**
+     * Counters of the last packet
+     */
+    uint32_t count0;
+    uint16_t count1;
+
+    /**
+     * Packets received per second during the last second, 0 if no packets are received for a second
+     */
+    double rate;
+  };
+
+  /**
+   * Keeps the statistics of a device. The counters are updated by the thread receiving the packets, they can be read by
+   * any thread (although the counters might be from different packets).
+   */
+  class LinkStatistics
+  {
+  public:
+    LinkStatistics();
+
+    void reset();
+
+    /**
+     * The next packet is not compared with the previous one, ie because packets were discarded on purpose in between
+     * (the receive context was restarted). Only call this from the thread receiving the packets.
+     */
+    void resync()
+    {
+      synced = false;
+    }
+
+    /**
+     * Called for every received packet
+     *
+     * @param dropped number of packets the driver dropped before this one
+     */
+    void received(uint32_t count0, uint16_t count1, unsigned int dropped)
+    {
+      uint64_t p = packets.load(std::memory_order_relaxed) + 1;
+      int32_t jump = count0 - expected;
+
+      if (p == 1 || !synced)
+      {
+        // Nothing to compare with (yet)
+        synced = true;
+      }
+      else if (jump == 0)
+      {
+        // Normal case
+      }
+      else if (jump == -1)
+      {
+        add(duplicates, 1);
+      }
+      else if (jump > 0 && jump <= LINK_STATISTICS_MAX_JUMP)
+      {
+        add(lost, jump);
+        add(gaps, 1);
+      }
+      else if (jump < 0 && jump >= -LINK_STATISTICS_MAX_JUMP)
+      {
+        // A late packet does not change the expected counter
+        add(reordered, 1);
+        count0 = expected - 1;
+      }
+      else
+      {
+        add(resyncs, 1);
+        if (count1 < lastCount1.load(std::memory_order_relaxed))
+        {
+          add(restarts, 1);
+        }
+      }
+
+      if (dropped)
+      {
+        add(this->dropped, dropped);
+      }
+      expected = count0 + 1;
+      lastCount0.store(count0, std::memory_order_relaxed);
+      lastCount1.store(count1, std::memory_order_relaxed);
+      packets.store(p, std::memory_order_relaxed);
+
+      if ((p & (LINK_STATISTICS_SAMPLE - 1)) == 0)
+      {
+        sample(p);
+      }
+    }
+
+    /**
+     * Called for every transmitted packet
+     */
+    void transmitted(unsigned int dropped)
+    {
+      if (dropped)
+      {
+        add(transmitDropped, dropped);
+      }
+    }
+
+    void get(PhantomLinkStatistics &statistics) const;
+
+  private:
+    std::atomic<uint64_t> packets, lost, gaps, duplicates, reordered, resyncs, restarts, dropped, transmitDropped;
+    std::atomic<uint32_t> lastCount0;
+    std::atomic<uint16_t> lastCount1;
+
+    /**
+     * Message counter of the next packet, only used by the receiving thread
+     */
+    uint32_t expected;
+
+    /**
+     * False when the next packet should not be compared with the expected counter, only used by the receiving thread
+     */
+    bool synced;
+
+    /**
+     * Time (in seconds) and number of packets of the last samples, only used by the receiving thread
+     */
+    double sampleTime[LINK_STATISTICS_SAMPLES];
+    uint64_t samplePackets[LINK_STATISTICS_SAMPLES];
+    unsigned int samples;
+
+    /**
+     * Rate determined at the last sample, and the time of that sample
+     */
+    std::atomic<double> rate;
+    std::atomic<double> rateTime;
+
+    // Counters only have a single writer, so no atomic read-modify-write is needed
+    static void add(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void sample(uint64_t packets);
+  };
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: asynchronous logging which can be used in the isochronous (hot) path
+ */
+
+#include <stdarg.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Log.h"
+
+using namespace LibPhantom;
+
+thread_local Log::Ring *Log::ring = 0;
+thread_local Log::RingOwner Log::owner;
+std::atomic<u_int64_t> Log::dropped(0);
+Log::Ring *Log::rings = 0;
+
+// Protects the list of rings and serialises the flushing
+static std::mutex mutex;
+static FILE *output = 0;
+
+static std::thread *flushThread = 0;
+static std::mutex flushMutex;
+static std::condition_variable flushCondition;
+static bool flushStop;
+
+static const char levelNames[] = "EWIDT";
+
+Log::RingOwner::~RingOwner()
+{
+  if (ring)
+  {
+    ring->owned.store(false, std::memory_order_release);
+    ring = 0;
+  }
+}
+
+Log::Ring *Log::acquireRing()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  Ring *r;
+  unsigned int count = 0;
+
+  // Reuse the ring of a thread which exited, once its records are flushed
+  for (r = rings; r; r = r->next, count++)
+  {
+    if (!r->owned.load(std::memory_order_acquire)
+        && r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_relaxed))
+    {
+      break;
+    }
+  }
+
+  if (!r)
+  {
+    r = new Ring();
+    r->head.store(0);
+    r->tail.store(0);
+    r->id = count;
+    r->next = rings;
+    rings = r;
+  }
+  r->owned.store(true);
+
+  // Make sure the owner is constructed, so its destructor releases the ring when the thread exits
+  (void) &owner;
+  ring = r;
+  return r;
+}
+
+u_int64_t Log::now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u_int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void Log::printFormat(FILE *out, const Record *record, ...)
+{
+  va_list args;
+
+  fprintf(out, "[%6llu.%06llu] %c: ", (unsigned long long) (record->time / 1000000000),
+      (unsigned long long) (record->time % 1000000000 / 1000), levelNames[record->level]);
+  va_start(args, record);
+  vfprintf(out, record->format, args);
+  va_end(args);
+  fputc('\n', out);
+}
+
+unsigned int Log::flush(FILE *out)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  unsigned int written = 0;
+
+  if (!out)
+  {
+    out = output ? output : stderr;
+  }
+
+  for (Ring *r = rings; r; r = r->next)
+  {
+    unsigned int tail = r->tail.load(std::memory_order_relaxed);
+    unsigned int head = r->head.load(std::memory_order_acquire);
+
+    for (; tail != head; tail++, written++)
+    {
+      const Record &record = r->records[tail & (PHANTOM_LOG_RING_SIZE - 1)];
+      record.print(out, record);
+    }
+    r->tail.store(tail, std::memory_order_release);
+  }
+
+  if (written)
+  {
+    fflush(out);
+  }
+  return written;
+}
+
+void Log::setOutput(FILE *out)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  output = out;
+}
+
+static void flushLoop(unsigned int interval)
+{
+  std::unique_lock<std::mutex> lock(flushMutex);
+  while (!flushStop)
+  {
+    flushCondition.wait_for(lock, std::chrono::milliseconds(interval));
+    Log::flush();
+  }
+}
+
+void Log::startThread(unsigned int interval)
+{
+  std::lock_guard<std::mutex> lock(flushMutex);
+  if (flushThread)
+  {
+    return;
+  }
+  flushStop = false;
+  flushThread = new std::thread(flushLoop, interval);
+}
+
+void Log::stopThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(flushMutex);
+    if (!flushThread)
+    {
+      return;
+    }
+    flushStop = true;
+  }
+  flushCondition.notify_all();
+  flushThread->join();
+  delete flushThread;
+  flushThread = 0;
+
+  flush();
+}
+
+u_int64_t Log::getDropped()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,250 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: asynchronous logging which can be used in the isochronous (hot) path
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <atomic>
+#include <type_traits>
+
+#define PHANTOM_LOG_LEVEL_ERROR    0
+#define PHANTOM_LOG_LEVEL_WARNING  1
+#define PHANTOM_LOG_LEVEL_INFO     2
+#define PHANTOM_LOG_LEVEL_DEBUG    3
+#define PHANTOM_LOG_LEVEL_TRACE    4
+
+// Messages with a higher level are removed at compile time, eg: make CFLAGS="-Wall -g -DUSE_libraw1394 -DPHANTOM_LOG_LEVEL=4"
+#ifndef PHANTOM_LOG_LEVEL
+#define PHANTOM_LOG_LEVEL          PHANTOM_LOG_LEVEL_INFO
+#endif
+
+// Number of records each thread can have pending before records get dropped (a power of 2)
+#define PHANTOM_LOG_RING_SIZE      256
+
+// Maximum size of the arguments of a single record
+#define PHANTOM_LOG_ARGS_SIZE      40
+
+/**
+ * Logs a printf style message. The format and string arguments are not copied, so they need to be string literals.
+ * Arguments can be numbers and pointers (which are printed with the format when the record is flushed).
+ */
+#define PHANTOM_LOG(level, ...) \
+  do \
+  { \
+    if ((level) <= PHANTOM_LOG_LEVEL) \
+    { \
+      if (0) \
+        LibPhantom::Log::check((level), __VA_ARGS__); \
+      LibPhantom::Log::write((level), __VA_ARGS__); \
+    } \
+  } while (0)
+
+#define PHANTOM_LOG_ERROR(...)     PHANTOM_LOG(PHANTOM_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define PHANTOM_LOG_WARNING(...)   PHANTOM_LOG(PHANTOM_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define PHANTOM_LOG_INFO(...)      PHANTOM_LOG(PHANTOM_LOG_LEVEL_INFO, __VA_ARGS__)
+#define PHANTOM_LOG_DEBUG(...)     PHANTOM_LOG(PHANTOM_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define PHANTOM_LOG_TRACE(...)     PHANTOM_LOG(PHANTOM_LOG_LEVEL_TRACE, __VA_ARGS__)
+
+namespace LibPhantom
+{
+  /**
+   * Logging without locks or stdio in the calling thread: each thread writes fixed size binary records into its own
+   * ring, the records are formatted by flush() (called explicitly or by the thread started with startThread(), which
+   * Phantom::startPhantom() starts when it is not running yet).
+   *
+   * When a ring is full the record is dropped (and counted), so logging never blocks.
+   */
+  class Log
+  {
+  public:
+    struct Record
+    {
+      u_int64_t time;
+      const char *format;
+
+      /**
+       * Prints the record, this function knows the types of the arguments
+       */
+      void (*print)(FILE *out, const Record &record);
+      unsigned char level;
+      unsigned char args[PHANTOM_LOG_ARGS_SIZE] __attribute__ ((aligned (8)));
+    };
+
+    /**
+     * Use the PHANTOM_LOG macros instead, those remove the call when the level is disabled
+     */
+    template<typename ... Args>
+    static void write(unsigned char level, const char *format, Args ... args)
+    {
+      static_assert(Packed<Args...>::size <= PHANTOM_LOG_ARGS_SIZE, "Too many log arguments");
+
+      Ring *r = ring ? ring : acquireRing();
+      unsigned int head = r->head.load(std::memory_order_relaxed);
+      if (head - r->tail.load(std::memory_order_acquire) == PHANTOM_LOG_RING_SIZE)
+      {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      Record &record = r->records[head & (PHANTOM_LOG_RING_SIZE - 1)];
+      record.time = now();
+      record.format = format;
+      record.print = &Packed<Args...>::print;
+      record.level = level;
+      Packed<Args...>::pack(record.args, args...);
+      r->head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Never called, only lets the compiler check the arguments against the format (the format attribute cannot be used
+     * on the variadic template write())
+     */
+    static void check(unsigned char level, const char *format, ...) __attribute__ ((format (printf, 2, 3)))
+    {
+    }
+
+    /**
+     * Formats the pending records of all threads
+     *
+     * @param out stream to write to, or 0 for the stream given to setOutput()
+     * @return number of records written
+     */
+    static unsigned int flush(FILE *out = 0);
+
+    /**
+     * Sets the stream flush() writes to (stderr by default)
+     */
+    static void setOutput(FILE *out);
+
+    /**
+     * Starts a thread which calls flush() every interval milliseconds
+     */
+    static void startThread(unsigned int interval = 10);
+
+    /**
+     * Stops the thread started with startThread() and flushes the remaining records
+     */
+    static void stopThread();
+
+    /**
+     * @return the number of records dropped because the ring of a thread was full
+     */
+    static u_int64_t getDropped();
+
+  private:
+    struct Ring
+    {
+      Record records[PHANTOM_LOG_RING_SIZE];
+      std::atomic<unsigned int> head; // Only written by the owning thread
+      std::atomic<unsigned int> tail; // Only written by flush()
+      std::atomic<bool> owned;
+      unsigned int id;
+      Ring *next;
+    };
+
+    /**
+     * Copies the arguments into a record, and calls printf with them again
+     */
+    template<typename ... Args>
+    struct Packed;
+
+    /**
+     * Gives the ring of a thread back when the thread exits, so another thread can reuse it
+     */
+    struct RingOwner
+    {
+      ~RingOwner();
+    };
+
+    /**
+     * Ring of the current thread, 0 until it logs for the first time
+     */
+    static thread_local Ring *ring;
+    static thread_local RingOwner owner;
+    static std::atomic<u_int64_t> dropped;
+
+    /**
+     * All rings which are created (they are reused, but never freed), protected by the mutex in Log.cpp
+     */
+    static Ring *rings;
+
+    /**
+     * Assigns a ring to the current thread (reusing an empty ring of a thread that exited)
+     */
+    static Ring *acquireRing();
+
+    /**
+     * @return monotonic time in nanoseconds
+     */
+    static u_int64_t now();
+
+    static void printFormat(FILE *out, const Record *record, ...);
+  };
+
+  template<>
+  struct Log::Packed<>
+  {
+    static const size_t size = 0;
+
+    static void pack(unsigned char *p)
+    {
+    }
+
+    template<typename ... Done>
+    static void print(FILE *out, const Record &record, const unsigned char *p, Done ... done)
+    {
+      printFormat(out, &record, done...);
+    }
+
+    static void print(FILE *out, const Record &record)
+    {
+      printFormat(out, &record);
+    }
+  };
+
+  template<typename T, typename ... Rest>
+  struct Log::Packed<T, Rest...>
+  {
+    static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value, "Only numbers and pointers can be logged");
+    static const size_t size = sizeof(T) + Packed<Rest...>::size;
+
+    static void pack(unsigned char *p, T value, Rest ... rest)
+    {
+      memcpy(p, &value, sizeof(T));
+      Packed<Rest...>::pack(p + sizeof(T), rest...);
+    }
+
+    template<typename ... Done>
+    static void print(FILE *out, const Record &record, const unsigned char *p, Done ... done)
+    {
+      T value;
+      memcpy(&value, p, sizeof(T));
+      Packed<Rest...>::print(out, record, p + sizeof(T), done..., value);
+    }
+
+    static void print(FILE *out, const Record &record)
+    {
+      print(out, record, record.args);
+    }
+  };
+}
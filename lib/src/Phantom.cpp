@@ -19,14 +19,22 @@
  * Phantom Library: implementation of Phantom functionality
  */
 
+#include <math.h>
+#include <algorithm>
+
 #include "DeviceIterator.h"
+#include "Log.h"
 #include "Phantom.h"
 #include "PhantomIsoChannel.h"
+#include "PhantomSpec.h"
 
 using namespace LibPhantom;
 
-Phantom::Phantom(FirewireDevice *fw) :
-  BaseDevice(fw), started(false)
+Phantom::Phantom(FirewireDevice *fw, uint32_t serial) :
+  BaseDevice(fw), serial(serial), started(false), paused(false), isoEnableCount(0), xmit_channel(0), recv_channel(0),
+      receiveCallback(0), transmitCallback(0), userdata(0), handlerInstaller(0), batchCallback(0), batchUserdata(0),
+      history(0), cycles(0), waiters(0), notifier(0), ownNotifier(0), notifiedSamples(0), idleEnabled(false),
+      idleInterval(0.02), idle(false)
 {
 
 }
@@ -35,11 +43,44 @@ Phantom::~Phantom()
 {
   // TODO Remove callback handler(s)
   stopPhantom();
+  delete ownNotifier;
+  delete history;
 }
 
 Phantom* Phantom::findPhantom()
 {
-  return findPhantom(0);
+  DeviceProbe *probe, *lowest = 0;
+  uint32_t lowestSerial = 0;
+  DeviceIterator *i = DeviceIterator::createInstance();
+
+  try
+  {
+    // Select the device with the lowest serial, so the same device is selected over and over. Only that device gets
+    // claimed, so other processes can still find the other devices.
+    for (probe = i->nextProbe(); probe; probe = i->nextProbe())
+    {
+      if (!probe->isSensableDevice())
+      {
+        continue;
+      }
+
+      uint32_t serial = readDeviceSerial(probe);
+      if (!lowest || serial < lowestSerial)
+      {
+        lowest = probe;
+        lowestSerial = serial;
+      }
+    }
+
+    Phantom *phantom = lowest ? new Phantom(i->claim(lowest), lowestSerial) : 0;
+    delete i;
+    return phantom;
+  }
+  catch (...)
+  {
+    delete i;
+    throw;
+  }
 }
 
 // If serial is 0, any Phantom device will suffice
@@ -47,26 +88,35 @@ Phantom* Phantom::findPhantom(unsigned int serial)
 {
   // TODO Cache the Phantom devices and recreate list upon bus resets (much more efficient, assuming that it does not take too much resources to create the list...)
 
-  FirewireDevice *dev;
+  DeviceProbe *probe;
   DeviceIterator *i = DeviceIterator::createInstance();
 
-  for (dev = i->next(); dev; dev = i->next())
+  try
   {
-    if (dev->isSensableDevice())
+    // Only the matching device gets claimed, the other probes are released together with the iterator
+    for (probe = i->nextProbe(); probe; probe = i->nextProbe())
     {
-      uint32_t device_serial = readDeviceSerial(dev);
+      if (!probe->isSensableDevice())
+      {
+        continue;
+      }
+
+      uint32_t device_serial = readDeviceSerial(probe);
       if (serial != 0 && serial != device_serial)
       {
-        delete dev;
         continue;
       }
 
       //We have found a Phantom device
+      Phantom *phantom = new Phantom(i->claim(probe), device_serial);
       delete i;
-      return new Phantom(dev);
+      return phantom;
     }
-
-    delete dev;
+  }
+  catch (...)
+  {
+    delete i;
+    throw;
   }
   delete i;
 
@@ -74,20 +124,100 @@ Phantom* Phantom::findPhantom(unsigned int serial)
   return 0;
 }
 
+typedef std::pair<uint32_t, DeviceProbe*> SerialProbe;
+
+static bool compareSerial(const SerialProbe &a, const SerialProbe &b)
+{
+  return a.first < b.first;
+}
+
+PhantomList Phantom::findAll()
+{
+  std::vector<SerialProbe> probes;
+  PhantomList phantoms;
+  DeviceProbe *probe;
+  DeviceIterator *i = DeviceIterator::createInstance();
+
+  try
+  {
+    for (probe = i->nextProbe(); probe; probe = i->nextProbe())
+    {
+      if (probe->isSensableDevice())
+      {
+        probes.push_back(SerialProbe(readDeviceSerial(probe), probe));
+      }
+    }
+
+    // Claim the devices in order of their serial
+    std::sort(probes.begin(), probes.end(), compareSerial);
+    for (std::vector<SerialProbe>::iterator it = probes.begin(); it != probes.end(); it++)
+    {
+      phantoms.push_back(new Phantom(i->claim(it->second), it->first));
+    }
+  }
+  catch (...)
+  {
+    // Release the devices claimed so far, otherwise they cannot be found anymore
+    for (PhantomList::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+    {
+      delete *it;
+    }
+    delete i;
+    throw;
+  }
+  delete i;
+
+  return phantoms;
+}
+
+PhantomSerialMap Phantom::findAllBySerial()
+{
+  PhantomList phantoms = findAll();
+  PhantomSerialMap map;
+
+  for (PhantomList::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+  {
+    if (map.count((*it)->getSerial()))
+    {
+      // The serial cannot tell these devices apart, so only the first one is kept
+      PHANTOM_LOG_WARNING("Found another device with serial %x, it is ignored", (*it)->getSerial());
+      delete *it;
+      continue;
+    }
+    map[(*it)->getSerial()] = *it;
+  }
+  return map;
+}
+
+uint32_t Phantom::getSerial()
+{
+  return serial;
+}
+
 uint32_t Phantom::readDeviceSerial()
 {
   return readDeviceSerial(firewireDevice);
 }
 
-uint32_t Phantom::readDeviceSerial(FirewireDevice *firewireDevice)
+uint32_t Phantom::readDeviceSerial(DeviceProbe *device)
 {
   uint32_t serial;
   // For a PHANTOM Omni this address can be read to obtain the serial/unique number
-  firewireDevice->read(0x10060010, (char *) &serial, 4);
+  device->read(0x10060010, (char *) &serial, 4);
   return serial;
 }
 
-void Phantom::startPhantom()
+unsigned int Phantom::getRequiredBandwidth(StartMode mode)
+{
+  unsigned int units = PhantomIsoChannel::bandwidthUnits(firewireDevice, true);
+  if (mode == FULL)
+  {
+    units += PhantomIsoChannel::bandwidthUnits(firewireDevice, false);
+  }
+  return units;
+}
+
+void Phantom::startPhantom(StartMode mode)
 {
   if (started)
   {
@@ -95,18 +225,24 @@ void Phantom::startPhantom()
     throw "This phantom device is already started";
   }
   started = true;
+  paused = false;
+  idle = false;
+
+  // The iterating thread only queues its log messages, starting the device is the first chance to write them
+  Log::startThread();
 
   try
   {
     recv_channel = new PhantomIsoChannel(firewireDevice, true);
     try
     {
-      xmit_channel = new PhantomIsoChannel(firewireDevice, false);
+      xmit_channel = mode == FULL ? new PhantomIsoChannel(firewireDevice, false) : 0;
     }
     catch (...)
     {
       // Failed to get both channels, free recv_channel
       delete recv_channel;
+      recv_channel = 0;
       throw;
     }
   }
@@ -117,8 +253,20 @@ void Phantom::startPhantom()
     throw;
   }
 
-  recv_channel->start();
-  xmit_channel->start();
+  recv_channel->setState(&state);
+  recv_channel->setHistory(history);
+  recv_channel->setEvents(&events);
+  recv_channel->setStatistics(&statistics);
+  recv_channel->setBatchCallback(batchCallback, batchUserdata);
+  applyCallbacks(recv_channel);
+  startChannel(recv_channel);
+  if (xmit_channel)
+  {
+    applyCallbacks(xmit_channel);
+    xmit_channel->setStatistics(&statistics);
+    xmit_channel->setForces(&forces);
+    startChannel(xmit_channel);
+  }
 }
 
 void Phantom::stopPhantom()
@@ -128,16 +276,432 @@ void Phantom::stopPhantom()
     return;
   }
   started = false;
-  recv_channel->stop();
-  xmit_channel->stop();
+  stopChannel(recv_channel);
+  if (xmit_channel)
+  {
+    stopChannel(xmit_channel);
+  }
 
   delete recv_channel;
   delete xmit_channel;
+  recv_channel = 0;
+  xmit_channel = 0;
+
+  Log::flush();
+}
+
+void Phantom::pausePhantom()
+{
+  if (!started)
+  {
+    // TODO Create some library exception and throw that one
+    throw "This phantom device is not started";
+  }
+  if (paused)
+  {
+    return;
+  }
+
+  setIsoEnabled(false);
+  paused = true;
+}
+
+void Phantom::resumePhantom()
+{
+  if (!started)
+  {
+    // TODO Create some library exception and throw that one
+    throw "This phantom device is not started";
+  }
+  if (!paused)
+  {
+    return;
+  }
+
+  if (isoEnableCount > 0)
+  {
+    setIsoEnabled(true);
+  }
+  paused = false;
+}
+
+bool Phantom::isPaused()
+{
+  return paused;
+}
+
+void Phantom::setIsoEnabled(bool enable)
+{
+  unsigned char c, control;
+
+  firewireDevice->read(ADDR_CONTROL, (char *) &c, 1);
+  control = enable ? c | ADDR_CONTROL_enable_iso : c & ~ADDR_CONTROL_enable_iso;
+  if (control != c)
+  {
+    firewireDevice->write(ADDR_CONTROL, (char *) &control, 1);
+  }
+}
+
+void Phantom::startChannel(PhantomIsoChannel *channel)
+{
+  channel->start();
+  if (isoEnableCount++ == 0 && !paused)
+  {
+    setIsoEnabled(true);
+  }
+}
+
+void Phantom::stopChannel(PhantomIsoChannel *channel)
+{
+  if (--isoEnableCount == 0 && !paused)
+  {
+    setIsoEnabled(false);
+  }
+  channel->stop();
+}
+
+void Phantom::setCallbacks(PhantomReceiveCallback receiveCallback, PhantomTransmitCallback transmitCallback,
+    void *userdata)
+{
+  this->receiveCallback = receiveCallback;
+  this->transmitCallback = transmitCallback;
+  this->userdata = userdata;
+  handlerInstaller = 0;
+
+  if (started)
+  {
+    applyCallbacks(recv_channel);
+    if (xmit_channel)
+    {
+      applyCallbacks(xmit_channel);
+    }
+  }
+}
+
+void Phantom::setHandler(PhantomIsoChannel::HandlerInstaller installer, void *handler)
+{
+  receiveCallback = 0;
+  transmitCallback = 0;
+  userdata = handler;
+  handlerInstaller = installer;
+
+  if (started)
+  {
+    applyCallbacks(recv_channel);
+    if (xmit_channel)
+    {
+      applyCallbacks(xmit_channel);
+    }
+  }
+}
+
+void Phantom::applyCallbacks(PhantomIsoChannel *channel)
+{
+  if (handlerInstaller)
+  {
+    handlerInstaller(channel, userdata);
+  }
+  else
+  {
+    channel->setCallbacks(receiveCallback, transmitCallback, userdata);
+  }
+}
+
+u_int64_t Phantom::getState(PhantomState &state) const
+{
+  return this->state.read(state);
+}
+
+void Phantom::setHistoryCapacity(unsigned int samples)
+{
+  if (started)
+  {
+    // TODO Create some library exception and throw that one
+    throw "The history cannot be resized while the phantom device is started";
+  }
+
+  delete history;
+  history = samples ? new SampleHistory(samples) : 0;
+}
+
+const SampleHistory *Phantom::getHistory() const
+{
+  return history;
+}
+
+void Phantom::setBatchCallback(PhantomBatchCallback batchCallback, void *userdata)
+{
+  this->batchCallback = batchCallback;
+  batchUserdata = userdata;
+
+  if (started)
+  {
+    recv_channel->setBatchCallback(batchCallback, userdata);
+  }
+}
+
+void Phantom::getLinkStatistics(PhantomLinkStatistics &statistics) const
+{
+  this->statistics.get(statistics);
+}
+
+void Phantom::resetLinkStatistics()
+{
+  statistics.reset();
+}
+
+void Phantom::setForces(const int16_t force[3], bool motorsOn)
+{
+  forces.set(force, motorsOn);
+}
+
+void Phantom::setStalePolicy(ForceOutput::StalePolicy policy, double deadline, double horizon)
+{
+  forces.setStalePolicy(policy, deadline, horizon);
+}
+
+void Phantom::getForceStatistics(PhantomForceStatistics &statistics) const
+{
+  forces.getStatistics(statistics);
 }
 
 void Phantom::isoIterate()
 {
+  isoReceive();
+  isoTransmit();
+}
+
+void Phantom::isoReceive()
+{
+  if (!recv_channel)
+  {
+    // TODO Create some library exception and throw that one
+    throw "This phantom device is not started";
+  }
   recv_channel->iterate();
-  xmit_channel->iterate();
+  finishReceive();
+}
+
+bool Phantom::isoPoll()
+{
+  if (!recv_channel)
+  {
+    // TODO Create some library exception and throw that one
+    throw "This phantom device is not started";
+  }
+  bool received = recv_channel->pollIterate();
+  if (received)
+  {
+    finishReceive();
+  }
+  if (xmit_channel)
+  {
+    xmit_channel->pollIterate();
+  }
+  return received;
+}
+
+void Phantom::finishReceive()
+{
+  cycles++;
+  updateIdle();
+
+  EventNotifier *n = notifier.load(std::memory_order_acquire);
+  if (n && state.getWritten() != notifiedSamples)
+  {
+    notifiedSamples = state.getWritten();
+    n->signal();
+  }
+
+  if (waiters)
+  {
+    resumeWaiters();
+  }
+}
+
+void Phantom::isoTransmit()
+{
+  if (xmit_channel)
+  {
+    xmit_channel->iterate();
+  }
+}
+
+void Phantom::isoPollTransmit()
+{
+  if (xmit_channel)
+  {
+    xmit_channel->pollIterate();
+  }
+}
+
+u_int64_t Phantom::getCycle() const
+{
+  return cycles;
+}
+
+PhantomSampleAwaiter Phantom::nextSample()
+{
+  PhantomState s;
+  return PhantomSampleAwaiter(this, state.read(s) + 1);
+}
+
+PhantomCycleAwaiter Phantom::nextCycle(unsigned int cycles)
+{
+  return PhantomCycleAwaiter(this, this->cycles + cycles);
+}
+
+bool Phantom::nextEvent(PhantomEvent &event)
+{
+  return events.pop(event);
+}
+
+void Phantom::setEventCallback(PhantomEventCallback callback, void *userdata)
+{
+  events.setCallback(callback, userdata);
+}
+
+uint64_t Phantom::getDroppedEvents() const
+{
+  return events.getDropped();
+}
+
+void Phantom::setIdlePolicy(bool enabled, double interval)
+{
+  idleInterval.store(std::min(interval, PHANTOM_IDLE_INTERVAL_MAX), std::memory_order_relaxed);
+  idleEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Phantom::isIdle() const
+{
+  return idle.load(std::memory_order_relaxed);
+}
+
+double Phantom::getIdleInterval() const
+{
+  return idleInterval.load(std::memory_order_relaxed);
+}
+
+void Phantom::updateIdle()
+{
+  bool now = idleEnabled.load(std::memory_order_relaxed) && events.isDocked() && forces.isIdle();
+  if (!recv_channel || now == idle.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+
+  unsigned int packets = now ? std::max(1L, lrint(getIdleInterval() * PHANTOM_PACKET_RATE)) : 1;
+  PHANTOM_LOG_INFO("Device %x %s idle mode (interrupt every %u packets)", serial, now ? "enters" : "leaves", packets);
+  recv_channel->setIdle(now);
+  recv_channel->setIrqInterval(packets);
+  // Changing the interval restarts the receive context, the packets lost meanwhile say nothing about the link
+  statistics.resync();
+  idle.store(now, std::memory_order_relaxed);
+}
+
+EventNotifier *Phantom::getNotifier()
+{
+  EventNotifier *n = notifier.load(std::memory_order_acquire);
+  if (!n)
+  {
+    if (!ownNotifier)
+    {
+      ownNotifier = new EventNotifier();
+    }
+    n = ownNotifier;
+    notifier.store(n, std::memory_order_release);
+  }
+  return n;
+}
+
+void Phantom::setNotifier(EventNotifier *notifier)
+{
+  this->notifier.store(notifier, std::memory_order_release);
+}
+
+void Phantom::resumeWaiters()
+{
+  PhantomState s;
+  u_int64_t samples = state.read(s);
+
+  // A resumed coroutine may link a new waiter (which waits for a next cycle) or destroy other waiters (which unlink
+  // themselves), so start over from the head after every resume
+  PhantomWaiter **w = &waiters;
+  while (*w)
+  {
+    PhantomWaiter *waiter = *w;
+    if (waiter->cycle == cycles || (waiter->samples ? samples : cycles) < waiter->target)
+    {
+      w = &waiter->next;
+      continue;
+    }
+
+    waiter->unlink();
+    waiter->resume(waiter->coroutine);
+    w = &waiters;
+  }
+}
+
+PhantomWaiter::PhantomWaiter(Phantom *phantom, bool samples, u_int64_t target) :
+  phantom(phantom), next(0), linked(false), samples(samples), target(target), cycle(0), coroutine(0), resume(0)
+{
+}
+
+PhantomWaiter::~PhantomWaiter()
+{
+  unlink();
+}
+
+bool PhantomWaiter::await_ready() const
+{
+  PhantomState s;
+  return (samples ? phantom->state.read(s) : phantom->cycles) >= target;
+}
+
+void PhantomWaiter::link()
+{
+  cycle = phantom->cycles;
+  next = phantom->waiters;
+  phantom->waiters = this;
+  linked = true;
+}
+
+void PhantomWaiter::unlink()
+{
+  if (!linked)
+  {
+    return;
+  }
+
+  for (PhantomWaiter **w = &phantom->waiters; *w; w = &(*w)->next)
+  {
+    if (*w == this)
+    {
+      *w = next;
+      break;
+    }
+  }
+  linked = false;
 }
 
+PhantomSampleAwaiter::PhantomSampleAwaiter(Phantom *phantom, u_int64_t target) :
+  PhantomWaiter(phantom, true, target)
+{
+}
+
+PhantomState PhantomSampleAwaiter::await_resume() const
+{
+  PhantomState s;
+  phantom->getState(s);
+  return s;
+}
+
+PhantomCycleAwaiter::PhantomCycleAwaiter(Phantom *phantom, u_int64_t target) :
+  PhantomWaiter(phantom, false, target)
+{
+}
+
+u_int64_t PhantomCycleAwaiter::await_resume() const
+{
+  return phantom->getCycle();
+}
@@ -22,20 +22,135 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
+#include <map>
+#include <vector>
 #include "BaseDevice.h"
+#include "EventNotifier.h"
+#include "PhantomIsoChannel.h"
+
+// Longest interval between iterations in idle mode (seconds), the driver buffers 1000 packets (one second)
+#define PHANTOM_IDLE_INTERVAL_MAX 0.25
+
+// Packets per second sent by the device
+#define PHANTOM_PACKET_RATE       1000
 
 namespace LibPhantom
 {
-  class PhantomIsoChannel;
+  class Phantom;
+
+  /**
+   * List of Phantom devices, ordered by serial (lowest first)
+   */
+  typedef std::vector<Phantom*> PhantomList;
+
+  /**
+   * Phantom devices indexed by their serial
+   */
+  typedef std::map<uint32_t, Phantom*> PhantomSerialMap;
+
+  /**
+   * Coroutine suspended until a device reached a cycle or sample count. Waiters live in the coroutine frame and are
+   * linked into a list of the device, so suspending and resuming does not allocate.
+   */
+  class PhantomWaiter
+  {
+  public:
+    PhantomWaiter(Phantom *phantom, bool samples, u_int64_t target);
+
+    /**
+     * Unlinks the waiter when the coroutine is destroyed while suspended
+     */
+    ~PhantomWaiter();
+
+    PhantomWaiter(const PhantomWaiter &) = delete;
+    PhantomWaiter &operator=(const PhantomWaiter &) = delete;
+
+    bool await_ready() const;
+
+    /**
+     * Works with the handle of any coroutine type (ie std::coroutine_handle<Promise>), so this header does not need C++20
+     */
+    template<typename Handle>
+    void await_suspend(Handle handle)
+    {
+      coroutine = handle.address();
+      resume = resumeHandle<Handle>;
+      link();
+    }
+
+  protected:
+    Phantom *phantom;
+    PhantomWaiter *next;
+    bool linked;
+
+    /**
+     * When true target is a number of received packets, otherwise a number of cycles
+     */
+    bool samples;
+    u_int64_t target;
+
+    /**
+     * Cycle in which the waiter was linked, it is not resumed in that same cycle
+     */
+    u_int64_t cycle;
+
+    void *coroutine;
+    void (*resume)(void *coroutine);
+
+    template<typename Handle>
+    static void resumeHandle(void *coroutine)
+    {
+      Handle::from_address(coroutine).resume();
+    }
+
+    void link();
+    void unlink();
+
+    friend class Phantom;
+  };
+
+  /**
+   * Result of co_await Phantom::nextSample(): the state of the newest packet
+   */
+  class PhantomSampleAwaiter : public PhantomWaiter
+  {
+  public:
+    PhantomSampleAwaiter(Phantom *phantom, u_int64_t target);
+    PhantomState await_resume() const;
+  };
+
+  /**
+   * Result of co_await Phantom::nextCycle(): the number of cycles done
+   */
+  class PhantomCycleAwaiter : public PhantomWaiter
+  {
+  public:
+    PhantomCycleAwaiter(Phantom *phantom, u_int64_t target);
+    u_int64_t await_resume() const;
+  };
 
   class Phantom : public BaseDevice
   {
   public:
+    enum StartMode
+    {
+      /**
+       * Receive the state of the device and transmit forces
+       */
+      FULL,
+
+      /**
+       * Only receive the state of the device (position, buttons): no transmit channel is allocated, so no bandwidth and
+       * isochronous context are used for it. Since the device never receives a force packet, its motors stay off.
+       */
+      RECEIVE_ONLY
+    };
+
     virtual ~Phantom();
 
     /**
-     * @return an unused phantom device, or 0 if there are no unused phantom devices found.
-     * @todo Return an unused Phantom devices with the lowest serial (to be able to easily select the same one over and over)
+     * @return the unused phantom device with the lowest serial, or 0 if there are no unused phantom devices found.
      */
     static Phantom* findPhantom();
 
@@ -45,51 +160,369 @@ namespace LibPhantom
      */
     static Phantom* findPhantom(unsigned int serial);
 
+    /**
+     * Claims all unused phantom devices in a single pass over the bus(ses). The serial of each device is read only once.
+     *
+     * @return the claimed devices, ordered by serial (lowest first). The caller owns (and needs to delete) the devices.
+     */
+    static PhantomList findAll();
+
+    /**
+     * Same as findAll(), but the devices are indexed by their serial. When devices report the same serial, only the
+     * first one is kept (the others are released and a warning is logged).
+     */
+    static PhantomSerialMap findAllBySerial();
+
+    /**
+     * @return serial id as read while finding the device (no communication with the device is required)
+     */
+    uint32_t getSerial();
+
     /**
      * @return serial id (read directly from device memory) or 0 when something went wrong
      */
     uint32_t readDeviceSerial();
 
     /**
-     * Starts the communication with the phantom
+     * @return the isochronous bandwidth (in allocation units) needed to start the device (see BandwidthPlanner)
+     */
+    unsigned int getRequiredBandwidth(StartMode mode = FULL);
+
+    /**
+     * Starts the communication with the phantom. This also starts the log thread (see Log::startThread()) if it is not
+     * running yet, so the messages logged while iterating get written.
      */
-    void startPhantom();
+    void startPhantom(StartMode mode = FULL);
 
     /**
-     * Stops the communication with the phantom
+     * Stops the communication with the phantom and writes the pending log messages
      */
     void stopPhantom();
 
+    /**
+     * Pauses the communication with the phantom: the device stops its isochronous transfers, but the channels, bandwidth
+     * and isochronous contexts stay allocated so resumePhantom() only needs to re-enable the device.
+     */
+    void pausePhantom();
+
+    /**
+     * Resumes the communication with the phantom after pausePhantom()
+     */
+    void resumePhantom();
+
+    /**
+     * @return true if the device is started, but paused
+     */
+    bool isPaused();
+
+    /**
+     * Sets the callbacks which are called (from isoIterate()) for each packet received from and transmitted to the device.
+     * Either callback may be 0: without a transmit callback no forces are applied. Do not call this while isoIterate() is
+     * running in another thread.
+     */
+    void setCallbacks(PhantomReceiveCallback receiveCallback, PhantomTransmitCallback transmitCallback,
+        void *userdata = 0);
+
+    /**
+     * Sets the callback which gets the decoded packets received during an isoIterate() at once, see BatchDecoder. Do
+     * not call this while isoIterate() is running in another thread.
+     */
+    void setBatchCallback(PhantomBatchCallback batchCallback, void *userdata = 0);
+
+    /**
+     * Same as setCallbacks(), but the packets are passed to handler->received(const PhantomDataRead &) and
+     * handler->transmit(PhantomDataWrite &). The packet handling is instantiated for the Handler type, so these calls
+     * are inlined instead of going through a callback pointer per packet (see PhantomIsoChannel::setHandler()).
+     */
+    template<class Handler>
+    void setHandler(Handler *handler)
+    {
+      setHandler(&PhantomIsoChannel::installHandler<Handler>, handler);
+    }
+
+    /**
+     * Copies the state of the latest packet received from the device. This can be called from any thread (also while
+     * another thread runs isoIterate()), it never blocks the thread receiving the packets.
+     *
+     * @return the number of packets received since the device was found (including the copied one), 0 if no packet is
+     *         received yet (state is not changed then)
+     */
+    u_int64_t getState(PhantomState &state) const;
+
+    /**
+     * Sets the number of received samples kept in the history (0 to keep none), only while the device is stopped. The
+     * history is allocated here, so receiving does not allocate.
+     */
+    void setHistoryCapacity(unsigned int samples);
+
+    /**
+     * @return the history of the received samples, which can be queried from any thread, or 0 if no history is kept
+     */
+    const SampleHistory *getHistory() const;
+
+    /**
+     * Copies the statistics of the isochronous link with the device (gaps in the message counter, dropped packets,
+     * rate). This can be called from any thread.
+     */
+    void getLinkStatistics(PhantomLinkStatistics &statistics) const;
+
+    /**
+     * Resets the statistics, do not call this while isoIterate() is running in another thread
+     */
+    void resetLinkStatistics();
+
+    /**
+     * Sets the forces to transmit, this can be called from any (single) thread. When no new forces are set before the
+     * deadline of the stale policy, the transmitted forces are determined by that policy instead.
+     *
+     * @param force force of the x, y and z axis, relative to no force
+     * @param motorsOn when false the motors are turned off
+     */
+    void setForces(const int16_t force[3], bool motorsOn = true);
+
+    /**
+     * Sets what to transmit when the forces are older than deadline seconds, see ForceOutput::StalePolicy
+     */
+    void setStalePolicy(ForceOutput::StalePolicy policy, double deadline = 0.002, double horizon = 0.01);
+
+    /**
+     * Copies the counters of deadline misses of the forces. This can be called from any thread.
+     */
+    void getForceStatistics(PhantomForceStatistics &statistics) const;
+
+    /**
+     * Takes the oldest button or dock event, this can be called from any (single) thread
+     *
+     * @return false if there are no events
+     */
+    bool nextEvent(PhantomEvent &event);
+
+    /**
+     * Sets the callback which is called (from the thread doing isoIterate()) for every button or dock event
+     */
+    void setEventCallback(PhantomEventCallback callback, void *userdata);
+
+    /**
+     * @return the number of events dropped because nextEvent() was not called often enough
+     */
+    uint64_t getDroppedEvents() const;
+
+    /**
+     * Enables the idle mode: while the gimbal is docked and no forces are commanded (see ForceOutput::isIdle()), the
+     * driver wakes up the iterating thread once per interval instead of for every packet, unchanged samples are not
+     * forwarded (nor stored, so nextSample() and the notifier do not fire for them) and ServoThread/DeviceScheduler
+     * iterate the device once per interval. The device leaves the idle mode within about one interval after undocking
+     * or setting forces.
+     *
+     * @param interval seconds between the iterations while idle, at most PHANTOM_IDLE_INTERVAL_MAX
+     */
+    void setIdlePolicy(bool enabled, double interval = 0.02);
+
+    /**
+     * @return true while the device is in idle mode
+     */
+    bool isIdle() const;
+
+    /**
+     * @return the interval (in seconds) between the iterations while idle
+     */
+    double getIdleInterval() const;
+
     /**
      * Do an isochronous iteration (ie see whether we need to transmit or receive data)
+     *
+     * @throws some exception when the device is not started
      */
     void isoIterate();
 
+    /**
+     * The two halves of isoIterate(): receive (and decode) the packets, and transmit the forces. A scheduler uses these
+     * to handle the same stage of several devices together. isoReceive() throws when the device is not started,
+     * isoTransmit() does nothing then.
+     */
+    void isoReceive();
+    void isoTransmit();
+
+    /**
+     * Non-blocking iteration for busy polling: handles the pending events of both channels
+     *
+     * @return true if packets were received (and the receive stage, like isoReceive(), is done)
+     * @throws some exception when the device is not started
+     */
+    bool isoPoll();
+
+    /**
+     * Non-blocking version of isoTransmit(), only handles the transmit events which are pending
+     */
+    void isoPollTransmit();
+
+    /**
+     * @return the number of cycles (isoIterate() or isoReceive() calls) done since the device was created
+     */
+    u_int64_t getCycle() const;
+
+    /**
+     * Awaitables for coroutines (C++20, see PhantomCoroutine.h for a task type). The coroutine is resumed at the end of
+     * isoReceive() by the thread iterating the device, so the forces it sets are transmitted in the same cycle. Only
+     * await them in coroutines running on that thread (or before the iterations start).
+     *
+     * co_await nextSample() resumes once a new packet is received and gives its PhantomState, co_await nextCycle(n)
+     * resumes after n cycles and gives the cycle number.
+     */
+    PhantomSampleAwaiter nextSample();
+    PhantomCycleAwaiter nextCycle(unsigned int cycles = 1);
+
+    /**
+     * @return the notifier which is signalled (at the end of isoReceive()) when new samples are received, the device
+     *         creates its own notifier when none is set
+     */
+    EventNotifier *getNotifier();
+
+    /**
+     * Sets the notifier to signal, ie one notifier for a group of devices, or 0 to stop signalling. The notifier needs
+     * to stay valid while it is set.
+     */
+    void setNotifier(EventNotifier *notifier);
+
   protected:
+    /**
+     * Serial id of the device, read once when the device was found
+     */
+    uint32_t serial;
+
     /**
      * When true, isochronous communication is enabled (ie the device is started)
      */
     bool started;
 
     /**
-     * Transmit isochronous channel
+     * When true, the device is started but its isochronous transfers are disabled (see pausePhantom())
+     */
+    bool paused;
+
+    /**
+     * Number of started isochronous channels, the isochronous enable bit of the device is set while this is non-zero
+     */
+    unsigned int isoEnableCount;
+
+    /**
+     * Transmit isochronous channel, 0 when not started or started with RECEIVE_ONLY
      */
     PhantomIsoChannel* xmit_channel;
 
     /**
-     * Receive isochronous channel
+     * Receive isochronous channel, 0 when not started
      */
     PhantomIsoChannel* recv_channel;
 
+    /**
+     * Application callbacks, passed to the channels when they are created
+     */
+    PhantomReceiveCallback receiveCallback;
+    PhantomTransmitCallback transmitCallback;
+    void *userdata;
+    PhantomIsoChannel::HandlerInstaller handlerInstaller;
+    PhantomBatchCallback batchCallback;
+    void *batchUserdata;
+
+    /**
+     * State of the latest packet received, for other threads
+     */
+    StateBuffer<PhantomState> state;
+
+    /**
+     * Recent samples, 0 if not kept
+     */
+    SampleHistory *history;
+
+    /**
+     * Statistics of the packets received (and transmitted)
+     */
+    LinkStatistics statistics;
+
+    /**
+     * Forces set by the application, for the transmit channel
+     */
+    ForceOutput forces;
+
+    /**
+     * Button and dock events of the received packets
+     */
+    ButtonEvents events;
+
+    /**
+     * Number of cycles done, and the coroutines waiting for a cycle or sample
+     */
+    u_int64_t cycles;
+    PhantomWaiter *waiters;
+
+    /**
+     * Notifier to signal for new samples, the notifier created by getNotifier() (if any) and the number of samples at
+     * the last signal
+     */
+    std::atomic<EventNotifier *> notifier;
+    EventNotifier *ownNotifier;
+    u_int64_t notifiedSamples;
+
+    /**
+     * Idle policy, and whether the device is idle now
+     */
+    std::atomic<bool> idleEnabled;
+    std::atomic<double> idleInterval;
+    std::atomic<bool> idle;
+
+    /**
+     * Enters or leaves the idle mode, called at the end of isoReceive()
+     */
+    void updateIdle();
+
+    /**
+     * Everything done after receiving: counting the cycle, idle mode, notifier and coroutines
+     */
+    void finishReceive();
+
+    /**
+     * Resumes the waiters which reached their target
+     */
+    void resumeWaiters();
+
+    friend class PhantomWaiter;
+
     /**
      * Do no use constructor directly, but use findPhantom() functionalities.
      */
-    Phantom(FirewireDevice *fw);
+    Phantom(FirewireDevice *fw, uint32_t serial);
 
     /**
      * @return serial id (read directly from device memory) or 0 when something went wrong
      */
-    static uint32_t readDeviceSerial(FirewireDevice *firewireDevice);
+    static uint32_t readDeviceSerial(DeviceProbe *device);
+
+    /**
+     * Sets or clears the isochronous enable bit of the device (for both directions)
+     */
+    void setIsoEnabled(bool enable);
+
+    /**
+     * Starts the channel and sets the isochronous enable bit of the device if it is the first started channel
+     */
+    void startChannel(PhantomIsoChannel *channel);
+
+    /**
+     * Stops the channel and clears the isochronous enable bit of the device if it was the last started channel, so the
+     * other direction keeps running when only one channel is stopped
+     */
+    void stopChannel(PhantomIsoChannel *channel);
+
+    /**
+     * Stores the handler set with setHandler(Handler *) and passes it to the channels if they are started
+     */
+    void setHandler(PhantomIsoChannel::HandlerInstaller installer, void *handler);
+
+    /**
+     * Passes the callbacks or the handler to the channel
+     */
+    void applyCallbacks(PhantomIsoChannel *channel);
 
   };
 }
@@ -0,0 +1,198 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: coroutine task type with preallocated frames (needs C++20)
+ */
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "PhantomCoroutine.h needs C++20 coroutines (ie compile with -std=c++20)"
+#endif
+
+#include <stddef.h>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+
+#include "Phantom.h"
+
+// Size of each preallocated coroutine frame in bytes, and the number of frames
+#ifndef PHANTOM_COROUTINE_FRAME_SIZE
+#define PHANTOM_COROUTINE_FRAME_SIZE 1024
+#endif
+#ifndef PHANTOM_COROUTINE_FRAMES
+#define PHANTOM_COROUTINE_FRAMES     64
+#endif
+
+namespace LibPhantom
+{
+  /**
+   * Fixed pool of coroutine frames, so creating a PhantomTask does not use the heap
+   */
+  class PhantomFramePool
+  {
+  public:
+    /**
+     * @throws some exception if size is larger than PHANTOM_COROUTINE_FRAME_SIZE or all frames are in use
+     */
+    static void *allocate(size_t size)
+    {
+      if (size > PHANTOM_COROUTINE_FRAME_SIZE)
+      {
+        // TODO Create some library exception and throw that one
+        throw "Coroutine frame is larger than PHANTOM_COROUTINE_FRAME_SIZE";
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!initialised)
+      {
+        for (unsigned int i = 0; i < PHANTOM_COROUTINE_FRAMES; i++)
+        {
+          *(void **) frames[i] = i + 1 < PHANTOM_COROUTINE_FRAMES ? frames[i + 1] : 0;
+        }
+        freeFrames = frames[0];
+        initialised = true;
+      }
+      if (!freeFrames)
+      {
+        // TODO Create some library exception and throw that one
+        throw "All PHANTOM_COROUTINE_FRAMES coroutine frames are in use";
+      }
+
+      void *frame = freeFrames;
+      freeFrames = *(void **) frame;
+      return frame;
+    }
+
+    static void release(void *frame)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      *(void **) frame = freeFrames;
+      freeFrames = frame;
+    }
+
+  private:
+    alignas(16) static inline unsigned char frames[PHANTOM_COROUTINE_FRAMES][PHANTOM_COROUTINE_FRAME_SIZE];
+    static inline void *freeFrames = 0;
+    static inline bool initialised = false;
+    static inline std::mutex mutex;
+  };
+
+  /**
+   * Coroutine which starts running immediately and is suspended at its co_await's, ie:
+   *
+   *   PhantomTask haptics(Phantom *phantom)
+   *   {
+   *     for (;;)
+   *     {
+   *       PhantomState state = co_await phantom->nextSample();
+   *       phantom->setForces(...);
+   *     }
+   *   }
+   *
+   * Its frame comes from PhantomFramePool. Destroying the task destroys the coroutine, also when it is suspended.
+   */
+  class PhantomTask
+  {
+  public:
+    struct promise_type
+    {
+      std::exception_ptr exception;
+
+      static void *operator new(size_t size)
+      {
+        return PhantomFramePool::allocate(size);
+      }
+
+      static void operator delete(void *frame)
+      {
+        PhantomFramePool::release(frame);
+      }
+
+      PhantomTask get_return_object()
+      {
+        return PhantomTask(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_never initial_suspend() noexcept
+      {
+        return std::suspend_never();
+      }
+
+      // Stay suspended at the end, so done() can be checked until the task is destroyed
+      std::suspend_always final_suspend() noexcept
+      {
+        return std::suspend_always();
+      }
+
+      void return_void()
+      {
+      }
+
+      void unhandled_exception()
+      {
+        exception = std::current_exception();
+      }
+    };
+
+    PhantomTask(PhantomTask &&other) :
+      handle(other.handle)
+    {
+      other.handle = 0;
+    }
+
+    PhantomTask(const PhantomTask &) = delete;
+    PhantomTask &operator=(const PhantomTask &) = delete;
+
+    ~PhantomTask()
+    {
+      if (handle)
+      {
+        handle.destroy();
+      }
+    }
+
+    /**
+     * @return true when the coroutine returned (or threw an exception, see rethrow())
+     */
+    bool done() const
+    {
+      return handle.done();
+    }
+
+    /**
+     * Throws the exception the coroutine ended with, if any
+     */
+    void rethrow() const
+    {
+      if (handle.promise().exception)
+      {
+        std::rethrow_exception(handle.promise().exception);
+      }
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+
+    PhantomTask(std::coroutine_handle<promise_type> handle) :
+      handle(handle)
+    {
+    }
+  };
+}
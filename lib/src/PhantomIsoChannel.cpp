@@ -25,28 +25,152 @@
 
 #include "Communication.h"
 #include "FirewireDevice.h"
+#include "Log.h"
 #include "PhantomSpec.h"
 
 using namespace LibPhantom;
 
 PhantomIsoChannel::PhantomIsoChannel(FirewireDevice *firewireDevice, bool receiving) :
-  firewireDevice(firewireDevice), receiving(receiving)
+  firewireDevice(firewireDevice), receiving(receiving), state(0), history(0), statistics(0), forces(0), events(0), idle(false), receiveCallback(0), transmitCallback(0), userdata(0),
+      backlog(0), receiveTrampoline(0), transmitTrampoline(0)
 {
   com = firewireDevice->createCommunication();
   com_config = firewireDevice->createCommunication();
 
-  channel = firewireDevice->getFreeChannel();
-  firewireDevice->claimChannel(channel);
-  printf("PhantomIsoChannel: com=%p\n",com);
+  try
+  {
+    channel = firewireDevice->allocateChannel();
+    bandwidth = bandwidthUnits(firewireDevice, receiving);
+    try
+    {
+      firewireDevice->allocateBandwidth(bandwidth);
+    }
+    catch (...)
+    {
+      firewireDevice->releaseChannel(channel);
+      throw;
+    }
+  }
+  catch (...)
+  {
+    delete com;
+    delete com_config;
+    throw;
+  }
+  PHANTOM_LOG_DEBUG("Allocated %s channel %u and %u bandwidth units", receiving ? "receive" : "transmit", channel,
+      bandwidth);
 }
 
 PhantomIsoChannel::~PhantomIsoChannel()
 {
   //TODO Should we check whether start() was called?
-  stop();
-  firewireDevice->releaseChannel(channel);
+  // Destructors must not throw, so failures are only logged (the resources are released by the next bus reset anyway)
+  try
+  {
+    stop();
+    firewireDevice->releaseBandwidth(bandwidth);
+    firewireDevice->releaseChannel(channel);
+  }
+  catch (const char *e)
+  {
+    PHANTOM_LOG_WARNING("Could not release %s channel %u: %s", receiving ? "receive" : "transmit", channel, e);
+  }
+  catch (...)
+  {
+    PHANTOM_LOG_WARNING("Could not release %s channel %u", receiving ? "receive" : "transmit", channel);
+  }
   delete com;
   delete com_config;
+  delete backlog;
+}
+
+unsigned int PhantomIsoChannel::bandwidthUnits(FirewireDevice *firewireDevice, bool receiving)
+{
+  unsigned int speed = firewireDevice->getSpeed();
+  if (speed > PHANTOM_ISO_SPEED)
+  {
+    speed = PHANTOM_ISO_SPEED;
+  }
+  return FirewireDevice::isoBandwidthUnits(receiving ? sizeof(PhantomDataRead) : sizeof(PhantomDataWrite), speed);
+}
+
+void PhantomIsoChannel::setCallbacks(PhantomReceiveCallback receiveCallback, PhantomTransmitCallback transmitCallback,
+    void *userdata)
+{
+  this->receiveCallback = receiveCallback;
+  this->transmitCallback = transmitCallback;
+  this->userdata = userdata;
+  receiveTrampoline = 0;
+  transmitTrampoline = 0;
+}
+
+void PhantomIsoChannel::setBatchCallback(PhantomBatchCallback batchCallback, void *userdata)
+{
+  if (!batchCallback)
+  {
+    delete backlog;
+    backlog = 0;
+    return;
+  }
+
+  if (!backlog)
+  {
+    backlog = new Backlog();
+    for (unsigned int i = 0; i < PHANTOM_BATCH_SIZE; i++)
+    {
+      backlog->pointers[i] = backlog->packets[i];
+    }
+    backlog->count = 0;
+  }
+  backlog->callback = batchCallback;
+  backlog->userdata = userdata;
+}
+
+void PhantomIsoChannel::flushBacklog()
+{
+  BatchDecoder::decode(backlog->pointers, backlog->count, backlog->batch);
+  backlog->count = 0;
+  backlog->callback(&backlog->batch, backlog->userdata);
+}
+
+void PhantomIsoChannel::setStatistics(LinkStatistics *statistics)
+{
+  this->statistics = statistics;
+}
+
+void PhantomIsoChannel::setForces(ForceOutput *forces)
+{
+  this->forces = forces;
+}
+
+void PhantomIsoChannel::setEvents(ButtonEvents *events)
+{
+  this->events = events;
+}
+
+void PhantomIsoChannel::setIdle(bool idle)
+{
+  if (idle && !this->idle)
+  {
+    // The first sample while idle is always forwarded
+    memset(lastSample, 0xff, sizeof(lastSample));
+  }
+  this->idle = idle;
+}
+
+void PhantomIsoChannel::setIrqInterval(unsigned int packets)
+{
+  com->setIrqInterval(packets);
+}
+
+void PhantomIsoChannel::setState(StateBuffer<PhantomState> *state)
+{
+  this->state = state;
+}
+
+void PhantomIsoChannel::setHistory(SampleHistory *history)
+{
+  this->history = history;
 }
 
 void PhantomIsoChannel::start()
@@ -110,17 +234,6 @@ void PhantomIsoChannel::start()
     sprintf(buf, "line %d: Expected 0x00 but got 0x%2.2x instead!\n", __LINE__, c);
     throw buf;
   }
-
-  // Tell Phantom to actual start the isochronous transfer
-  com_config->read(ADDR_CONTROL, (char *) &c, 1);
-  if (!(c & ADDR_CONTROL_enable_iso))
-  {
-    // Not started yet, so start
-    c |= ADDR_CONTROL_enable_iso;
-    com_config->write(ADDR_CONTROL, (char *) &c, 1);
-  }
-
-
 }
 
 void PhantomIsoChannel::stop()
@@ -146,16 +259,6 @@ void PhantomIsoChannel::stop()
     throw buf;
   }
 
-  //TODO This stops both receiving and transmitting... might need some code to only stop if last transfer got stopped (instead of first)
-  // Tell Phantom to stop the isochronous transfer
-  com_config->read(ADDR_CONTROL, (char *) &c, 1);
-  if (c & ADDR_CONTROL_enable_iso)
-  {
-    // Transfer is enabled, so stop it
-    c &= ADDR_CONTROL_enable_iso;
-    com_config->write(ADDR_CONTROL, (char *) &c, 1);
-  }
-
   com->stopIsoTransfer();
 }
 
@@ -164,41 +267,23 @@ void PhantomIsoChannel::iterate()
   //TODO Check if this is really required (and thus is non-blocking)
   // Use select() for this, for an example see rev-eng/omni.c
   com->doIterate();
-}
 
-void PhantomIsoChannel::receivedData(unsigned char *data, unsigned int len)
-{
-  //TODO Call application callback to do something with the data
-  PhantomDataRead *d = (PhantomDataRead *) data;
-  printf("Encoder      X %6hd Y %6hd Z %6hd\n", d->encoder_x, d->encoder_y, d->encoder_z);
-  printf("Gimbal       X %6hd Y %6hd Z %6hd\n", d->gimbal.x, d->gimbal.y, d->gimbal.z);
-  printf("Gimbal (inv) X %6hu Y %6hu Z %6hu\n", d->gimbal_inv.x, d->gimbal_inv.y, d->gimbal_inv.z);
-  if(d->status.button1 == 0)
-    printf("Button1 pressed\n");
-  else
-    printf("\n");
-  if(d->status.button2 == 0)
-    printf("Button2 pressed\n");
-  else
-    printf("\n");
-  if(d->status.docked == 0)
-    printf("Gimbal docked\n");
-  else
-    printf("\n");
+  if (backlog && backlog->count)
+  {
+    flushBacklog();
+  }
 }
 
-void PhantomIsoChannel::transmitData(unsigned char *data, unsigned int *len)
+bool PhantomIsoChannel::pollIterate()
 {
-  //TODO Call application callback to get new data to send to Phantom device
-
-  // No forces are enabled
-  PhantomDataWrite *d = (PhantomDataWrite *) data;
-  d->force_x     = 0x7ff;
-  d->force_y     = 0x7ff;
-  d->force_z     = 0x7ff;
-  d->status.bits = 0x53c0;
-  d->unused1     = 0;
-  d->unused2     = 0;
+  if (!com->pollIterate())
+  {
+    return false;
+  }
 
-  *len = sizeof(struct PhantomDataWrite);
+  if (backlog && backlog->count)
+  {
+    flushBacklog();
+  }
+  return true;
 }
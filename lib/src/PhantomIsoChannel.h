@@ -21,11 +21,35 @@
 
 #pragma once
 
+#include <string.h>
+#include "BatchDecoder.h"
+#include "ButtonEvents.h"
+#include "ForceOutput.h"
+#include "LinkStatistics.h"
+#include "SampleHistory.h"
+#include "PhantomPacket.h"
+#include "StateBuffer.h"
+
 namespace LibPhantom
 {
   class Communication;
   class FirewireDevice;
 
+  /**
+   * Called for each packet received from the device
+   */
+  typedef void (*PhantomReceiveCallback)(const PhantomDataRead *data, void *userdata);
+
+  /**
+   * Called for each packet to transmit to the device. The packet is initialised with zero forces and the motors off.
+   */
+  typedef void (*PhantomTransmitCallback)(PhantomDataWrite *data, void *userdata);
+
+  /**
+   * Called once per iteration with the decoded packets received during that iteration
+   */
+  typedef void (*PhantomBatchCallback)(const PhantomStateBatch *batch, void *userdata);
+
   class PhantomIsoChannel
   {
   public:
@@ -33,12 +57,13 @@ namespace LibPhantom
     ~PhantomIsoChannel();
 
     /**
-     * (Re)starts the isochronous communication
+     * (Re)starts the isochronous communication. The device itself only starts transferring when its isochronous enable
+     * bit is set, which is shared by both directions and therefore is managed by Phantom.
      */
     void start();
 
     /**
-     * Stops the isochronous communication
+     * Stops the isochronous communication (the isochronous enable bit of the device is not touched)
      */
     void stop();
 
@@ -47,8 +72,121 @@ namespace LibPhantom
      */
     void iterate();
 
-    void receivedData(unsigned char *data, unsigned int len);
-    void transmitData(unsigned char *data, unsigned int *len);
+    /**
+     * Non-blocking iteration, see Communication::pollIterate()
+     *
+     * @return true if there were events
+     */
+    bool pollIterate();
+
+    /**
+     * @return the isochronous bandwidth (in allocation units) a channel needs for the given device
+     */
+    static unsigned int bandwidthUnits(FirewireDevice *firewireDevice, bool receiving);
+
+    /**
+     * Sets the callback which is called for each received (or transmitted) packet. Only the callback for the direction of
+     * this channel is used. Do not call this while iterate() is running in another thread.
+     */
+    void setCallbacks(PhantomReceiveCallback receiveCallback, PhantomTransmitCallback transmitCallback, void *userdata);
+
+    /**
+     * Sets the callback which gets all packets received during an iteration at once (decoded by the BatchDecoder), or 0.
+     * This is called after the receive callback has been called for each of the packets.
+     */
+    void setBatchCallback(PhantomBatchCallback batchCallback, void *userdata);
+
+    /**
+     * Sets the buffer in which every received packet is stored decoded (before the receive callback is called), or 0
+     */
+    void setState(StateBuffer<PhantomState> *state);
+
+    /**
+     * Sets the history to which every received packet is added (decoded), or 0
+     */
+    void setHistory(SampleHistory *history);
+
+    /**
+     * Sets the statistics which are updated for every packet, or 0
+     */
+    void setStatistics(LinkStatistics *statistics);
+
+    /**
+     * Sets the forces which are transmitted (before the transmit callback is called), or 0 to transmit no forces
+     */
+    void setForces(ForceOutput *forces);
+
+    /**
+     * Sets the events which are updated for every received packet, or 0
+     */
+    void setEvents(ButtonEvents *events);
+
+    /**
+     * While idle, received samples which equal the previous sample (apart from the message counters) are not stored
+     * or forwarded to the callbacks. The statistics and events are still updated for every packet.
+     */
+    void setIdle(bool idle);
+
+    /**
+     * Sets after how many packets the driver wakes up the iterating thread, see Communication::setIrqInterval()
+     */
+    void setIrqInterval(unsigned int packets);
+
+    /**
+     * Instantiations of the packet handling for a handler type, see setHandler()
+     */
+    typedef void (*ReceiveTrampoline)(PhantomIsoChannel *channel, unsigned char *data, unsigned int len,
+        unsigned int dropped);
+    typedef void (*TransmitTrampoline)(PhantomIsoChannel *channel, unsigned char *data, unsigned int *len,
+        unsigned int dropped);
+
+    /**
+     * Passes the packets to handler->received(const PhantomDataRead &) and handler->transmit(PhantomDataWrite &)
+     * instead of the callbacks. The handling of the packets is instantiated for the Handler type, so the calls are
+     * resolved at compile time and inlined: the isochronous handler makes a single indirect call to the instantiation.
+     * Do not call this while iterate() is running in another thread.
+     */
+    template<class Handler>
+    void setHandler(Handler *handler)
+    {
+      receiveCallback = 0;
+      transmitCallback = 0;
+      userdata = handler;
+      receiveTrampoline = &handlerReceived<Handler>;
+      transmitTrampoline = &handlerTransmit<Handler>;
+    }
+
+    /**
+     * Calls setHandler() on the channel, so the Handler type can be stored until the channel exists (see Phantom)
+     */
+    typedef void (*HandlerInstaller)(PhantomIsoChannel *channel, void *handler);
+
+    template<class Handler>
+    static void installHandler(PhantomIsoChannel *channel, void *handler)
+    {
+      channel->setHandler(static_cast<Handler *> (handler));
+    }
+
+    // Called from the isochronous handlers of Communication for every packet, so inline
+    void receivedData(unsigned char *data, unsigned int len, unsigned int dropped = 0)
+    {
+      if (receiveTrampoline)
+      {
+        receiveTrampoline(this, data, len, dropped);
+        return;
+      }
+      receive(data, len, dropped, CallbackDispatch { this });
+    }
+
+    void transmitData(unsigned char *data, unsigned int *len, unsigned int dropped = 0)
+    {
+      if (transmitTrampoline)
+      {
+        transmitTrampoline(this, data, len, dropped);
+        return;
+      }
+      transmit(data, len, dropped, CallbackDispatch { this });
+    }
   protected:
     /**
      * Phantom device to which the isochronous channels belongs to
@@ -74,5 +212,177 @@ namespace LibPhantom
      * Claimed isochronous channel
      */
     unsigned int channel;
+
+    /**
+     * Reserved isochronous bandwidth (in allocation units)
+     */
+    unsigned int bandwidth;
+
+    StateBuffer<PhantomState> *state;
+    SampleHistory *history;
+    LinkStatistics *statistics;
+    ForceOutput *forces;
+    ButtonEvents *events;
+    bool idle;
+    unsigned char lastSample[PhantomPacketLayout::COUNT0.offset - PhantomPacketLayout::ENCODER_X.offset];
+    PhantomReceiveCallback receiveCallback;
+    PhantomTransmitCallback transmitCallback;
+    void *userdata;
+
+    /**
+     * Packets received during the current iteration, only allocated when a batch callback is set
+     */
+    struct Backlog
+    {
+      unsigned char packets[PHANTOM_BATCH_SIZE][PhantomPacketLayout::READ_SIZE];
+      const unsigned char *pointers[PHANTOM_BATCH_SIZE];
+      unsigned int count;
+      PhantomStateBatch batch;
+      PhantomBatchCallback callback;
+      void *userdata;
+    } *backlog;
+
+    /**
+     * Decodes the packets in the backlog and passes them to the batch callback
+     */
+    void flushBacklog();
+
+    ReceiveTrampoline receiveTrampoline;
+    TransmitTrampoline transmitTrampoline;
+
+    /**
+     * Passes the packets to the callbacks set with setCallbacks()
+     */
+    struct CallbackDispatch
+    {
+      PhantomIsoChannel *channel;
+
+      void received(const PhantomDataRead *data) const
+      {
+        if (channel->receiveCallback)
+        {
+          channel->receiveCallback(data, channel->userdata);
+        }
+      }
+
+      void transmit(PhantomDataWrite *data) const
+      {
+        if (channel->transmitCallback)
+        {
+          channel->transmitCallback(data, channel->userdata);
+        }
+      }
+    };
+
+    /**
+     * Passes the packets to a handler set with setHandler()
+     */
+    template<class Handler>
+    struct HandlerDispatch
+    {
+      Handler *handler;
+
+      void received(const PhantomDataRead *data) const
+      {
+        handler->received(*data);
+      }
+
+      void transmit(PhantomDataWrite *data) const
+      {
+        handler->transmit(*data);
+      }
+    };
+
+    template<class Handler>
+    static void handlerReceived(PhantomIsoChannel *channel, unsigned char *data, unsigned int len, unsigned int dropped)
+    {
+      channel->receive(data, len, dropped, HandlerDispatch<Handler> { static_cast<Handler *> (channel->userdata) });
+    }
+
+    template<class Handler>
+    static void handlerTransmit(PhantomIsoChannel *channel, unsigned char *data, unsigned int *len, unsigned int dropped)
+    {
+      channel->transmit(data, len, dropped, HandlerDispatch<Handler> { static_cast<Handler *> (channel->userdata) });
+    }
+
+    /**
+     * Handling of the packets, shared by the callbacks and the handlers
+     */
+    template<class Dispatch>
+    void receive(unsigned char *data, unsigned int len, unsigned int dropped, Dispatch dispatch)
+    {
+      if (len < sizeof(PhantomDataRead))
+      {
+        return;
+      }
+      if (statistics)
+      {
+        statistics->received(readField(data, PhantomPacketLayout::COUNT0), readField(data, PhantomPacketLayout::COUNT1),
+            dropped);
+      }
+      if (events)
+      {
+        events->received(data);
+      }
+      if (idle)
+      {
+        // Everything up to the message counters: encoders, gimbal and status
+        const unsigned int offset = PhantomPacketLayout::ENCODER_X.offset;
+        if (memcmp(lastSample, data + offset, sizeof(lastSample)) == 0)
+        {
+          return;
+        }
+        memcpy(lastSample, data + offset, sizeof(lastSample));
+      }
+      if (state || history)
+      {
+        PhantomState decoded;
+        decodePhantomState(data, decoded);
+        if (state)
+        {
+          state->write(decoded);
+        }
+        if (history)
+        {
+          history->write(decoded, SampleHistory::now());
+        }
+      }
+      dispatch.received((const PhantomDataRead *) data);
+      if (backlog)
+      {
+        if (backlog->count == PHANTOM_BATCH_SIZE)
+        {
+          flushBacklog();
+        }
+        memcpy(backlog->packets[backlog->count++], data, PhantomPacketLayout::READ_SIZE);
+      }
+    }
+
+    template<class Dispatch>
+    void transmit(unsigned char *data, unsigned int *len, unsigned int dropped, Dispatch dispatch)
+    {
+      if (statistics)
+      {
+        statistics->transmitted(dropped);
+      }
+
+      if (forces)
+      {
+        // The packet is needed now, so the stale policy decides when the application is late
+        uint16_t force[3];
+        uint16_t status = forces->evaluate(ForceOutput::now(), force);
+        encodePhantomForces(data, force, status);
+      }
+      else
+      {
+        // No forces are enabled, unless the callback says otherwise
+        static const uint16_t none[3] = { PhantomPacketLayout::FORCE_NONE, PhantomPacketLayout::FORCE_NONE,
+            PhantomPacketLayout::FORCE_NONE };
+        encodePhantomForces(data, none, PhantomPacketLayout::STATUS_DEFAULT);
+      }
+
+      dispatch.transmit((PhantomDataWrite *) data);
+      *len = sizeof(struct PhantomDataWrite);
+    }
   };
 }
@@ -0,0 +1,189 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: decoding and encoding of the isochronous packets without depending on the compiler's bitfield layout
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "PhantomSpec.h"
+
+namespace LibPhantom
+{
+  /**
+   * Decoded state of the device, as received in a single packet
+   */
+  struct PhantomState
+  {
+    /**
+     * Encoders of the x, y and z axis
+     */
+    uint16_t encoder[3];
+
+    /**
+     * Gimbal angles of the x, y and z axis (11 bits, the erratic least significant bits are removed)
+     */
+    uint16_t gimbal[3];
+
+    /**
+     * Message counter of the device (count0) and the slower counter (count1)
+     */
+    uint32_t count0;
+    uint16_t count1;
+
+    /**
+     * 1 when the button is pressed or the gimbal is docked, 0 otherwise
+     */
+    uint8_t button1;
+    uint8_t button2;
+    uint8_t docked;
+  };
+
+  /**
+   * Layout of the fields in the packets. All fields are little endian, a field is (value >> shift) & mask of the 16 bit
+   * word (or 32 bit word if mask does not fit in 16 bits) at offset.
+   */
+  namespace PhantomPacketLayout
+  {
+    struct Field
+    {
+      unsigned int offset;
+      unsigned int shift;
+      uint32_t mask;
+    };
+
+    // Packets received from the device
+    constexpr Field ENCODER_X = { 4, 0, 0xffff };
+    constexpr Field ENCODER_Y = { 6, 0, 0xffff };
+    constexpr Field ENCODER_Z = { 8, 0, 0xffff };
+    constexpr Field GIMBAL_X = { 10, 5, 0x7ff };
+    constexpr Field GIMBAL_Y = { 12, 5, 0x7ff };
+    constexpr Field GIMBAL_Z = { 14, 5, 0x7ff };
+    constexpr Field BUTTON1 = { 18, 8, 1 }; // Status bits are active low
+    constexpr Field BUTTON2 = { 18, 9, 1 };
+    constexpr Field DOCKED = { 18, 10, 1 };
+    constexpr Field COUNT0 = { 32, 0, 0xffffffff };
+    constexpr Field COUNT1 = { 40, 0, 0xffff };
+    constexpr unsigned int READ_SIZE = 44;
+
+    // Packets sent to the device
+    constexpr Field FORCE_X = { 0, 0, 0xffff };
+    constexpr Field FORCE_Y = { 2, 0, 0xffff };
+    constexpr Field FORCE_Z = { 4, 0, 0xffff };
+    constexpr Field STATUS = { 6, 0, 0xffff };
+    constexpr unsigned int WRITE_SIZE = 16;
+
+    // Bits of STATUS
+    constexpr uint16_t STATUS_DL_FLASH = 1 << 0;
+    constexpr uint16_t STATUS_DL_FFLASH = 1 << 1;
+    constexpr uint16_t STATUS_MOTORS_ON = 1 << 3;
+
+    // Force which is applied when the motors are off, and the status bits which are always sent (see rev-eng/omni.c)
+    constexpr uint16_t FORCE_NONE = 0x7ff;
+    constexpr uint16_t FORCE_MAX = 0xfff; // Forces are 12 bits, offset by FORCE_NONE
+    constexpr uint16_t STATUS_DEFAULT = 0x53c0;
+  }
+
+  inline uint16_t readLe16(const unsigned char *p)
+  {
+    return p[0] | p[1] << 8;
+  }
+
+  inline uint32_t readLe32(const unsigned char *p)
+  {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+  }
+
+  inline void writeLe16(unsigned char *p, uint16_t value)
+  {
+    p[0] = value;
+    p[1] = value >> 8;
+  }
+
+  inline uint32_t readField(const unsigned char *packet, const PhantomPacketLayout::Field &field)
+  {
+    uint32_t word = field.mask > 0xffff ? readLe32(packet + field.offset) : readLe16(packet + field.offset);
+    return (word >> field.shift) & field.mask;
+  }
+
+  /**
+   * Writes value into a field of a 16 bit word, the other bits of the word are kept (unless the field is the whole word)
+   */
+  inline void writeField(unsigned char *packet, const PhantomPacketLayout::Field &field, uint16_t value)
+  {
+    uint16_t mask = field.mask << field.shift;
+    if (mask == 0xffff)
+    {
+      writeLe16(packet + field.offset, value << field.shift);
+      return;
+    }
+    uint16_t word = readLe16(packet + field.offset);
+    writeLe16(packet + field.offset, (word & ~mask) | ((value << field.shift) & mask));
+  }
+
+  /**
+   * Decodes a packet received from the device (of at least PhantomPacketLayout::READ_SIZE bytes)
+   */
+  inline void decodePhantomState(const unsigned char *packet, PhantomState &state)
+  {
+    using namespace PhantomPacketLayout;
+
+    state.encoder[0] = readField(packet, ENCODER_X);
+    state.encoder[1] = readField(packet, ENCODER_Y);
+    state.encoder[2] = readField(packet, ENCODER_Z);
+    state.gimbal[0] = readField(packet, GIMBAL_X);
+    state.gimbal[1] = readField(packet, GIMBAL_Y);
+    state.gimbal[2] = readField(packet, GIMBAL_Z);
+    state.count0 = readField(packet, COUNT0);
+    state.count1 = readField(packet, COUNT1);
+    state.button1 = readField(packet, BUTTON1) ^ 1;
+    state.button2 = readField(packet, BUTTON2) ^ 1;
+    state.docked = readField(packet, DOCKED) ^ 1;
+  }
+
+  /**
+   * Encodes a packet to send to the device (of PhantomPacketLayout::WRITE_SIZE bytes)
+   *
+   * @param force forces of the x, y and z axis (FORCE_NONE means no force)
+   * @param status status bits (STATUS_DEFAULT combined with STATUS_MOTORS_ON etc)
+   */
+  inline void encodePhantomForces(unsigned char *packet, const uint16_t force[3], uint16_t status)
+  {
+    using namespace PhantomPacketLayout;
+
+    writeField(packet, FORCE_X, force[0]);
+    writeField(packet, FORCE_Y, force[1]);
+    writeField(packet, FORCE_Z, force[2]);
+    writeField(packet, STATUS, status);
+    for (unsigned int i = 8; i < WRITE_SIZE; i++)
+    {
+      packet[i] = 0;
+    }
+  }
+
+  // The structs of PhantomSpec.h describe the same layout (on little endian hosts)
+  static_assert(offsetof(PhantomDataRead, encoder_x) == PhantomPacketLayout::ENCODER_X.offset, "Layout mismatch");
+  static_assert(offsetof(PhantomDataRead, gimbal) == PhantomPacketLayout::GIMBAL_X.offset, "Layout mismatch");
+  static_assert(offsetof(PhantomDataRead, unknown9a) == PhantomPacketLayout::BUTTON1.offset, "Layout mismatch");
+  static_assert(offsetof(PhantomDataRead, count0) == PhantomPacketLayout::COUNT0.offset, "Layout mismatch");
+  static_assert(offsetof(PhantomDataRead, count1) == PhantomPacketLayout::COUNT1.offset, "Layout mismatch");
+  static_assert(sizeof(PhantomDataRead) == PhantomPacketLayout::READ_SIZE, "Layout mismatch");
+  static_assert(sizeof(PhantomDataWrite) == PhantomPacketLayout::WRITE_SIZE, "Layout mismatch");
+}
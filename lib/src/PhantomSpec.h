@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 // List of addresses which can be used to configure the PHANTOM device
 #define ADDR_XMIT_CHANNEL          0x1000  /* sets the xmit isochronous channel */
 #define ADDR_RECV_CHANNEL          0x1001  /* sets the recv isochronous channel */
@@ -28,6 +30,15 @@
 #define ADDR_CONTROL_enable_iso    (1<<3)  /*   bit 3 enables the isochronous data transfer of the device
                                             *   other bits are unknown and always seems to be zero?
                                             */
+
+// Speed code of the isochronous packets of the PHANTOM device (in both directions)
+#define PHANTOM_ISO_SPEED          0       /* S100 */
+
+/*
+ * The structs below describe the packets using bitfields, which only match the packets on little endian hosts with a
+ * compiler which allocates bitfields from the least significant bit (like GCC on x86). PhantomPacket.h decodes the
+ * packets independent of the host.
+ */
 namespace LibPhantom
 {
   /**
@@ -0,0 +1,156 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: history of the received samples, which can be queried from any thread
+ */
+
+#include "SampleHistory.h"
+
+using namespace LibPhantom;
+
+SampleHistory::SampleHistory(unsigned int capacity) :
+  count(0), written(0)
+{
+  unsigned int size = 1;
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+
+  slots = new Slot[size];
+  mask = size - 1;
+  for (unsigned int i = 0; i < size; i++)
+  {
+    slots[i].seq.store(0, std::memory_order_relaxed);
+  }
+}
+
+SampleHistory::~SampleHistory()
+{
+  delete[] slots;
+}
+
+unsigned int SampleHistory::getCapacity() const
+{
+  return mask + 1;
+}
+
+u_int64_t SampleHistory::getCount() const
+{
+  return count.load(std::memory_order_acquire);
+}
+
+bool SampleHistory::get(u_int64_t index, PhantomSample &sample) const
+{
+  const Slot &slot = slots[index & mask];
+  unsigned long buffer[WORDS];
+
+  if (slot.seq.load(std::memory_order_acquire) != 2 * index + 2)
+  {
+    return false;
+  }
+  for (unsigned int i = 0; i < WORDS; i++)
+  {
+    buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.seq.load(std::memory_order_relaxed) != 2 * index + 2)
+  {
+    // Overwritten while copying
+    return false;
+  }
+
+  memcpy(&sample, buffer, sizeof(sample));
+  return true;
+}
+
+bool SampleHistory::getNewest(PhantomSample &sample) const
+{
+  // Only fails when nothing is written, or when the writer wrapped around the whole ring meanwhile
+  for (;;)
+  {
+    u_int64_t c = getCount();
+    if (c == 0)
+    {
+      return false;
+    }
+    if (get(c - 1, sample))
+    {
+      return true;
+    }
+  }
+}
+
+template<class Before>
+u_int64_t SampleHistory::search(u_int64_t first, u_int64_t last, Before before) const
+{
+  PhantomSample sample;
+
+  while (first < last)
+  {
+    u_int64_t middle = first + (last - first) / 2;
+    if (!get(middle, sample) || before(sample))
+    {
+      first = middle + 1;
+    }
+    else
+    {
+      last = middle;
+    }
+  }
+  return first;
+}
+
+bool SampleHistory::getCycle(uint32_t count0, PhantomSample &sample) const
+{
+  u_int64_t last = getCount();
+  u_int64_t first = last > getCapacity() ? last - getCapacity() : 0;
+
+  // The message counter increases (and wraps around), so compare relative to the searched counter
+  u_int64_t index = search(first, last, [count0](const PhantomSample &s)
+  {
+    return (int32_t) (s.state.count0 - count0) < 0;
+  });
+  return index < last && get(index, sample) && sample.state.count0 == count0;
+}
+
+unsigned int SampleHistory::getWindow(double from, double to, PhantomSample *samples, unsigned int max) const
+{
+  u_int64_t last = getCount();
+  u_int64_t first = last > getCapacity() ? last - getCapacity() : 0;
+  unsigned int n = 0;
+
+  u_int64_t index = search(first, last, [from](const PhantomSample &s)
+  {
+    return s.time < from;
+  });
+  for (; index < last && n < max; index++)
+  {
+    if (!get(index, samples[n]))
+    {
+      // Overwritten meanwhile, the newer samples are still fine
+      continue;
+    }
+    if (samples[n].time > to)
+    {
+      break;
+    }
+    n++;
+  }
+  return n;
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: history of the received samples, which can be queried from any thread
+ */
+
+#pragma once
+
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <atomic>
+#include "PhantomPacket.h"
+
+namespace LibPhantom
+{
+  /**
+   * Received sample, with the time (CLOCK_MONOTONIC, in seconds) it was received
+   */
+  struct PhantomSample
+  {
+    PhantomState state;
+    double time;
+  };
+
+  /**
+   * Keeps the last samples of a device in a ring of cache line aligned slots. The ring is allocated once, writing and
+   * reading do not allocate or lock. There is a single writer (the receiving thread) and any number of readers.
+   *
+   * Samples are numbered from 0 in the order they are received. Each slot has a sequence number which tells which
+   * sample it holds (and whether it is being written), so a reader detects when the sample it copies is overwritten.
+   */
+  class SampleHistory
+  {
+  public:
+    /**
+     * @param capacity number of samples kept, rounded up to a power of 2
+     */
+    SampleHistory(unsigned int capacity);
+    ~SampleHistory();
+
+    SampleHistory(const SampleHistory &) = delete;
+    SampleHistory &operator=(const SampleHistory &) = delete;
+
+    unsigned int getCapacity() const;
+
+    /**
+     * Adds a sample, may only be called by a single thread at a time
+     */
+    void write(const PhantomState &state, double time)
+    {
+      PhantomSample sample;
+      unsigned long buffer[WORDS];
+      Slot &slot = slots[written & mask];
+
+      sample.state = state;
+      sample.time = time;
+      buffer[WORDS - 1] = 0;
+      memcpy(buffer, &sample, sizeof(sample));
+
+      slot.seq.store(2 * written + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (unsigned int i = 0; i < WORDS; i++)
+      {
+        slot.words[i].store(buffer[i], std::memory_order_relaxed);
+      }
+      slot.seq.store(2 * written + 2, std::memory_order_release);
+
+      count.store(++written, std::memory_order_release);
+    }
+
+    /**
+     * @return the number of samples written, the newest sample has number getCount() - 1
+     */
+    u_int64_t getCount() const;
+
+    /**
+     * Copies sample number index
+     *
+     * @return false if that sample is not written yet or already overwritten
+     */
+    bool get(u_int64_t index, PhantomSample &sample) const;
+
+    /**
+     * Copies the newest sample
+     *
+     * @return false if no sample is written yet
+     */
+    bool getNewest(PhantomSample &sample) const;
+
+    /**
+     * Copies the sample of the given device cycle (message counter count0), found with a binary search
+     *
+     * @return false if the history does not contain that cycle
+     */
+    bool getCycle(uint32_t count0, PhantomSample &sample) const;
+
+    /**
+     * Copies the samples received between from and to (inclusive), oldest first
+     *
+     * @return the number of samples copied, at most max
+     */
+    unsigned int getWindow(double from, double to, PhantomSample *samples, unsigned int max) const;
+
+    /**
+     * @return the time (CLOCK_MONOTONIC) in seconds, as used for the samples
+     */
+    static double now()
+    {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+  private:
+    static const unsigned int WORDS = (sizeof(PhantomSample) + sizeof(unsigned long) - 1) / sizeof(unsigned long);
+
+    struct alignas(64) Slot
+    {
+      /**
+       * 2 * index + 2 when sample index is stored, odd while it is being written
+       */
+      std::atomic<u_int64_t> seq;
+      std::atomic<unsigned long> words[WORDS];
+    };
+
+    Slot *slots;
+    unsigned int mask;
+
+    /**
+     * Number of samples written, the writer keeps its own copy
+     */
+    std::atomic<u_int64_t> count;
+    u_int64_t written;
+
+    /**
+     * @return the index of the first sample in [first, last) for which before() is false, found with a binary search
+     *         (samples overwritten during the search count as before)
+     */
+    template<class Before>
+    u_int64_t search(u_int64_t first, u_int64_t last, Before before) const;
+  };
+}
@@ -0,0 +1,341 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: managed (real-time) thread doing the isochronous iterations of devices
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <exception>
+
+#include "Log.h"
+#include "Phantom.h"
+#include "ServoThread.h"
+
+using namespace LibPhantom;
+
+static double toSeconds(const struct timespec &ts)
+{
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void addNanoseconds(struct timespec &ts, long nsec)
+{
+  ts.tv_nsec += nsec;
+  while (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_nsec -= 1000000000;
+    ts.tv_sec++;
+  }
+}
+
+ServoThread::ServoThread() :
+  callback(0), userdata(0), rate(1000), priority(80), cpu(-1), lock(true), locked(false), busyPoll(false),
+      thread(0),
+      stopping(false), running(false), error(0), cycles(0), overruns(0), period(0), maxJitter(0), rmsJitter(0),
+      realtime(false), pinned(false)
+{
+}
+
+ServoThread::~ServoThread()
+{
+  stop();
+}
+
+void ServoThread::add(Phantom *phantom)
+{
+  phantoms.push_back(phantom);
+}
+
+void ServoThread::setCallback(PhantomServoCallback callback, void *userdata)
+{
+  this->callback = callback;
+  this->userdata = userdata;
+}
+
+void ServoThread::setRate(double rate)
+{
+  this->rate = rate;
+}
+
+void ServoThread::setPriority(int priority)
+{
+  this->priority = priority;
+}
+
+void ServoThread::setCpu(int cpu)
+{
+  this->cpu = cpu;
+}
+
+void ServoThread::setLockMemory(bool lock)
+{
+  this->lock = lock;
+}
+
+void ServoThread::setBusyPoll(bool busyPoll)
+{
+  this->busyPoll = busyPoll;
+}
+
+void ServoThread::start()
+{
+  if (thread)
+  {
+    // TODO Create some library exception and throw that one
+    throw "The servo thread is already started";
+  }
+
+  if (lock && !locked)
+  {
+    locked = lockMemory();
+  }
+
+  cycles.store(0, std::memory_order_relaxed);
+  overruns.store(0, std::memory_order_relaxed);
+  error.store(0, std::memory_order_relaxed);
+  stopping.store(false, std::memory_order_relaxed);
+  running.store(true, std::memory_order_release);
+  thread = new std::thread(&ServoThread::run, this);
+}
+
+void ServoThread::stop()
+{
+  if (!thread)
+  {
+    return;
+  }
+
+  stopping.store(true, std::memory_order_relaxed);
+  thread->join();
+  delete thread;
+  thread = 0;
+}
+
+bool ServoThread::isRunning() const
+{
+  return running.load(std::memory_order_acquire);
+}
+
+const char *ServoThread::getError() const
+{
+  return error.load(std::memory_order_acquire);
+}
+
+void ServoThread::getStatistics(PhantomServoStatistics &statistics) const
+{
+  statistics.cycles = cycles.load(std::memory_order_relaxed);
+  statistics.overruns = overruns.load(std::memory_order_relaxed);
+  statistics.period = period.load(std::memory_order_relaxed);
+  statistics.maxJitter = maxJitter.load(std::memory_order_relaxed);
+  statistics.rmsJitter = rmsJitter.load(std::memory_order_relaxed);
+  statistics.realtime = realtime.load(std::memory_order_relaxed);
+  statistics.pinned = pinned.load(std::memory_order_relaxed);
+  statistics.locked = locked;
+}
+
+bool ServoThread::setRealtime(int priority)
+{
+  struct sched_param param;
+  param.sched_priority = priority;
+  int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (result != 0)
+  {
+    PHANTOM_LOG_WARNING("Could not set SCHED_FIFO priority %d (error %d), using normal scheduling", priority, result);
+    return false;
+  }
+  return true;
+}
+
+bool ServoThread::pinToCpu(int cpu)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (result != 0)
+  {
+    PHANTOM_LOG_WARNING("Could not run on CPU %d (error %d), using any CPU", cpu, result);
+    return false;
+  }
+  return true;
+#else
+  PHANTOM_LOG_WARNING("CPU affinity is not supported on this platform, using any CPU");
+  return false;
+#endif
+}
+
+void ServoThread::prefaultStack()
+{
+  unsigned char stack[SERVO_THREAD_STACK_PREFAULT];
+  long page = sysconf(_SC_PAGESIZE);
+  if (page <= 0)
+  {
+    page = 4096;
+  }
+  for (long i = 0; i < SERVO_THREAD_STACK_PREFAULT; i += page)
+  {
+    stack[i] = 0;
+  }
+
+  // Tell the compiler the array is used, otherwise it drops the writes
+  asm volatile("" : : "r" (stack) : "memory");
+}
+
+bool ServoThread::lockMemory()
+{
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+  {
+    PHANTOM_LOG_WARNING("Could not lock memory (errno %d), page faults may delay the servo loop", errno);
+    return false;
+  }
+  return true;
+}
+
+void ServoThread::run()
+{
+  realtime.store(priority > 0 && setRealtime(priority), std::memory_order_relaxed);
+  pinned.store(cpu >= 0 && pinToCpu(cpu), std::memory_order_relaxed);
+  prefaultStack();
+  if (busyPoll && cpu < 0)
+  {
+    PHANTOM_LOG_WARNING("Busy polling without CPU affinity, the spinning thread may share a CPU with others");
+  }
+
+  long nominal = rate > 0 ? lrint(1e9 / rate) : 0;
+  struct timespec next, now;
+  double last = -1, first = 0, sumSquares = 0, maxDeviation = 0, idleTime = 0;
+  uint64_t n = 0, late = 0;
+  long idle = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  try
+  {
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+      bool polling = busyPoll && !idle;
+      if (polling)
+      {
+        bool received = false;
+        for (std::vector<Phantom *>::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+        {
+          received = (*it)->isoPoll() || received;
+        }
+        if (!received)
+        {
+          relax();
+          continue;
+        }
+      }
+      else if (idle || nominal)
+      {
+        addNanoseconds(next, idle ? idle : nominal);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+      }
+
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      double t = toSeconds(now);
+      if (idle)
+      {
+        // Idle periods do not count for the timing statistics
+        idleTime += t - last;
+      }
+      else if (polling)
+      {
+        // The packets set the pace, the next sleep (when idle) starts from here
+        next = now;
+      }
+      else if (nominal && t - toSeconds(next) > nominal * 1e-9)
+      {
+        // Skip the missed periods instead of running them back to back
+        next = now;
+        overruns.store(++late, std::memory_order_relaxed);
+      }
+
+      if (last < 0)
+      {
+        first = t;
+      }
+      else if (!idle)
+      {
+        // The mean period is the reference without a configured rate
+        double mean = (t - first - idleTime) / (n + 1);
+        double deviation = fabs(t - last - (nominal ? nominal * 1e-9 : mean));
+        sumSquares += deviation * deviation;
+        if (deviation > maxDeviation)
+        {
+          maxDeviation = deviation;
+          maxJitter.store(maxDeviation, std::memory_order_relaxed);
+        }
+        period.store(mean, std::memory_order_relaxed);
+        rmsJitter.store(sqrt(sumSquares / (n + 1)), std::memory_order_relaxed);
+        n++;
+      }
+      last = t;
+
+      // Sleep for the (shortest) idle interval when all devices are idle
+      idle = phantoms.empty() ? 0 : LONG_MAX;
+      for (std::vector<Phantom *>::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+      {
+        if (!polling)
+        {
+          (*it)->isoIterate();
+        }
+        if (idle && (*it)->isIdle())
+        {
+          idle = std::min(idle, lrint((*it)->getIdleInterval() * 1e9));
+        }
+        else
+        {
+          idle = 0;
+        }
+      }
+      if (callback)
+      {
+        callback(userdata);
+      }
+      cycles.store(cycles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+  catch (const char *e)
+  {
+    PHANTOM_LOG_ERROR("Servo thread stopped: %s", e);
+    error.store(e, std::memory_order_release);
+  }
+  catch (const std::exception &e)
+  {
+    // The message of the exception does not outlive it, and the log only keeps pointers to strings
+    PHANTOM_LOG_ERROR("Servo thread stopped by a std::exception");
+    error.store("Exception raised in the servo thread", std::memory_order_release);
+  }
+  catch (...)
+  {
+    PHANTOM_LOG_ERROR("Servo thread stopped by an unknown exception");
+    error.store("Unknown exception raised in the servo thread", std::memory_order_release);
+  }
+  running.store(false, std::memory_order_release);
+}
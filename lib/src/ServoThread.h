@@ -0,0 +1,201 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: managed (real-time) thread doing the isochronous iterations of devices
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Amount of stack (in bytes) touched before the loop starts, so the loop does not page fault on its stack
+#define SERVO_THREAD_STACK_PREFAULT (64 * 1024)
+
+namespace LibPhantom
+{
+  class Phantom;
+
+  typedef void (*PhantomServoCallback)(void *userdata);
+
+  /**
+   * Timing of the servo loop, and which of the real-time settings could be applied
+   */
+  struct PhantomServoStatistics
+  {
+    /**
+     * Number of iterations done
+     */
+    uint64_t cycles;
+
+    /**
+     * Number of iterations started more than a period late (the loop skips those periods instead of catching up)
+     */
+    uint64_t overruns;
+
+    /**
+     * Achieved period (mean), and the largest and RMS deviation from the configured period (in seconds). Without a
+     * configured rate the deviation is from the mean period.
+     */
+    double period;
+    double maxJitter;
+    double rmsJitter;
+
+    /**
+     * True if the real-time priority, the CPU affinity and the memory locking were applied
+     */
+    bool realtime;
+    bool pinned;
+    bool locked;
+  };
+
+  /**
+   * Thread which calls Phantom::isoIterate() of its (started) devices at a fixed rate, followed by the callback. It
+   * tries to run with SCHED_FIFO on the given CPU with all memory locked, but runs without these when the privileges are
+   * missing (a warning is logged and the statistics tell what is applied). While all devices are idle (see
+   * Phantom::setIdlePolicy()) it iterates once per idle interval, these iterations are not part of the statistics.
+   */
+  class ServoThread
+  {
+  public:
+    ServoThread();
+
+    /**
+     * Stops the thread, the devices are not stopped
+     */
+    ~ServoThread();
+
+    /**
+     * Adds a device to iterate, only before start()
+     */
+    void add(Phantom *phantom);
+
+    /**
+     * Sets the function called after every iteration of all devices, only before start()
+     */
+    void setCallback(PhantomServoCallback callback, void *userdata);
+
+    /**
+     * @param rate iterations per second, 0 to iterate as fast as the devices allow (isoIterate() blocks until there is
+     *        data)
+     */
+    void setRate(double rate);
+
+    /**
+     * @param priority SCHED_FIFO priority, 0 to keep the normal scheduling
+     */
+    void setPriority(int priority);
+
+    /**
+     * @param cpu CPU to run on, -1 for any
+     */
+    void setCpu(int cpu);
+
+    /**
+     * @param lock when true all current and future memory of the process is locked (mlockall()) at start(), it stays
+     *        locked after stop() since other threads may depend on it
+     */
+    void setLockMemory(bool lock);
+
+    /**
+     * @param busyPoll when true the thread spins on Phantom::isoPoll() instead of waiting for the driver, which avoids
+     *        the interrupt and wakeup latency at the cost of a full CPU (so also use setCpu()). An iteration is done for
+     *        every received packet, the rate is only used as the reference for the jitter. While all devices are idle
+     *        the thread sleeps as usual.
+     */
+    void setBusyPoll(bool busyPoll);
+
+    void start();
+
+    /**
+     * Stops the thread after its current iteration
+     */
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * @return the error which stopped the thread (an exception of isoIterate() or the callback), or 0. For exceptions
+     *         other than strings the message is only logged.
+     */
+    const char *getError() const;
+
+    /**
+     * Copies the statistics, this can be called from any thread
+     */
+    void getStatistics(PhantomServoStatistics &statistics) const;
+
+    /**
+     * Real-time settings for the calling thread, a warning is logged when they cannot be applied
+     *
+     * @return true if applied
+     */
+    static bool setRealtime(int priority);
+    static bool pinToCpu(int cpu);
+
+    /**
+     * Touches SERVO_THREAD_STACK_PREFAULT bytes of the stack of the calling thread
+     */
+    static void prefaultStack();
+
+    /**
+     * Locks all memory of the process (see setLockMemory()), a warning is logged when it fails
+     *
+     * @return true if locked
+     */
+    static bool lockMemory();
+
+    /**
+     * Tells the CPU the thread is spinning (ie the pause instruction)
+     */
+    static void relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      asm volatile("yield");
+#endif
+    }
+
+  private:
+    std::vector<Phantom *> phantoms;
+    PhantomServoCallback callback;
+    void *userdata;
+    double rate;
+    int priority;
+    int cpu;
+    bool lock;
+    bool locked;
+    bool busyPoll;
+
+    std::thread *thread;
+    std::atomic<bool> stopping, running;
+    std::atomic<const char *> error;
+
+    /**
+     * Statistics, only written by the thread
+     */
+    std::atomic<uint64_t> cycles, overruns;
+    std::atomic<double> period, maxJitter, rmsJitter;
+    std::atomic<bool> realtime, pinned;
+
+    void run();
+  };
+}
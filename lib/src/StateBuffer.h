@@ -0,0 +1,148 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Phantom Library: latest state of a device, which can be read from any thread
+ */
+
+#pragma once
+
+#include <string.h>
+#include <sys/types.h>
+#include <atomic>
+#include <type_traits>
+
+namespace LibPhantom
+{
+  /**
+   * Keeps the latest value written by a single writer (the isochronous thread), which can be read by any number of
+   * reader threads. Writing never waits for readers. The writer fills the slot after the latest one, so a reader only
+   * needs to retry when the writer wrapped around all slots while it was copying the latest value.
+   *
+   * Each slot is protected by a sequence number (odd while it is being written), the data is copied as relaxed atomic
+   * words so the concurrent copies are well defined.
+   */
+  template<class T, unsigned int SLOTS = 4>
+  class StateBuffer
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "StateBuffer can only contain trivially copyable types");
+
+  public:
+    StateBuffer() :
+      latest(0), count(0)
+    {
+      for (unsigned int i = 0; i < SLOTS; i++)
+      {
+        slots[i].seq.store(0, std::memory_order_relaxed);
+        slots[i].count.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    /**
+     * Stores a new value, may only be called by a single thread at a time
+     */
+    void write(const T &value)
+    {
+      unsigned long buffer[WORDS];
+      unsigned int next = (latest.load(std::memory_order_relaxed) + 1) % SLOTS;
+      Slot &slot = slots[next];
+      unsigned int seq = slot.seq.load(std::memory_order_relaxed);
+
+      buffer[WORDS - 1] = 0;
+      memcpy(buffer, &value, sizeof(T));
+
+      slot.seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (unsigned int i = 0; i < WORDS; i++)
+      {
+        slot.words[i].store(buffer[i], std::memory_order_relaxed);
+      }
+      slot.count.store(++count, std::memory_order_relaxed);
+      slot.seq.store(seq + 2, std::memory_order_release);
+
+      latest.store(next, std::memory_order_release);
+    }
+
+    /**
+     * Copies the latest value
+     *
+     * @return the number of values written up to and including the copied one, 0 when nothing is written yet (value is
+     *         not changed then)
+     */
+    u_int64_t read(T &value) const
+    {
+      unsigned long buffer[WORDS];
+      u_int64_t c;
+
+      for (;;)
+      {
+        const Slot &slot = slots[latest.load(std::memory_order_acquire)];
+        unsigned int seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+          // The writer wrapped around and is writing this slot right now
+          continue;
+        }
+
+        for (unsigned int i = 0; i < WORDS; i++)
+        {
+          buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        c = slot.count.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq)
+        {
+          break;
+        }
+      }
+
+      if (c)
+      {
+        memcpy(&value, buffer, sizeof(T));
+      }
+      return c;
+    }
+
+    /**
+     * @return the number of values written, may only be called by the writer
+     */
+    u_int64_t getWritten() const
+    {
+      return count;
+    }
+
+  private:
+    static const unsigned int WORDS = (sizeof(T) + sizeof(unsigned long) - 1) / sizeof(unsigned long);
+
+    // Slots are cache line aligned, so writing one slot does not disturb readers of another slot
+    struct alignas(64) Slot
+    {
+      std::atomic<unsigned int> seq;
+      std::atomic<u_int64_t> count;
+      std::atomic<unsigned long> words[WORDS];
+    };
+
+    Slot slots[SLOTS];
+    alignas(64) std::atomic<unsigned int> latest;
+
+    /**
+     * Number of values written, only used by the writer
+     */
+    u_int64_t count;
+  };
+}
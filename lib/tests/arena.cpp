@@ -0,0 +1,120 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test that the arena (and the device enumeration using it) does not allocate memory once the first
+ * arena is recycled
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Arena.h"
+#include "DeviceIterator.h"
+
+using namespace LibPhantom;
+
+extern "C" void *__libc_malloc(size_t size);
+
+static int mallocs = 0;
+
+// Count the allocations of the whole program (glibc only)
+extern "C" void *malloc(size_t size)
+{
+  mallocs++;
+  return __libc_malloc(size);
+}
+
+int main()
+{
+  printf("Test 1: recycling the block of a destroyed arena\n");
+  delete new Arena(1024);
+  {
+    Arena a(1024);
+    a.allocate(512);
+  }
+  int before = mallocs;
+  for (int i = 0; i < 100; i++)
+  {
+    Arena a(1024);
+    a.allocate(512);
+    a.allocate(256);
+  }
+  if (mallocs != before)
+  {
+    printf("Error: %d allocations while recreating the arena\n", mallocs - before);
+    return 1;
+  }
+
+  printf("Test 2: reset() keeps the oldest block only\n");
+  {
+    Arena a(1024);
+    a.allocate(1024);
+    before = mallocs;
+    a.allocate(1024);
+    if (mallocs != before + 1)
+    {
+      printf("Error: no block was added when the first one got full\n");
+      return 1;
+    }
+    a.reset();
+    before = mallocs;
+    a.allocate(1024);
+    if (mallocs != before)
+    {
+      printf("Error: oldest block was not reused after reset()\n");
+      return 1;
+    }
+    a.allocate(1024);
+    if (mallocs != before + 1)
+    {
+      printf("Error: the added block was not freed by reset()\n");
+      return 1;
+    }
+  }
+
+  printf("Test 3: steady-state enumeration of the probes\n");
+  int devices = 0;
+  for (int round = 0; round < 3; round++)
+  {
+    DeviceIterator *i = DeviceIterator::createInstance(false);
+    before = mallocs;
+    int found = 0;
+    for (DeviceProbe *probe = i->nextProbe(); probe; probe = i->nextProbe())
+    {
+      probe->getVendorId();
+      found++;
+    }
+    int allocations = mallocs - before;
+    delete i;
+
+    if (round > 0 && found == devices && allocations != 0)
+    {
+      printf("Error: %d allocations while enumerating %d devices\n", allocations, found);
+      return 1;
+    }
+    devices = found;
+  }
+  if (devices == 0)
+  {
+    printf("No device was found\n");
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the BandwidthPlanner functionality
+ */
+
+#include <stdio.h>
+
+#include "BandwidthPlanner.h"
+
+using namespace LibPhantom;
+
+static int checkPorts(BandwidthPlanner &planner)
+{
+  const std::vector<BandwidthPlanner::PortPlan> &ports = planner.getPorts();
+  for (unsigned int i = 0; i < ports.size(); i++)
+  {
+    printf("Port %u: %u units available, %u planned, %u headroom, %u devices rejected, %u downgraded\n", ports[i].port,
+        ports[i].available, ports[i].planned, ports[i].headroom, ports[i].rejected, ports[i].downgraded);
+    if (ports[i].planned + ports[i].headroom != ports[i].available)
+    {
+      printf("Error: planned and headroom do not add up to the available bandwidth...\n");
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main()
+{
+  PhantomList phantoms;
+
+  try
+  {
+    phantoms = Phantom::findAll();
+    if (phantoms.empty())
+      return 0; // Nothing fun to do...
+
+    // All devices should fit on an otherwise idle bus
+    BandwidthPlanner planner;
+    planner.add(phantoms);
+    bool all = planner.plan();
+    printf("All devices fit: %s\n", all ? "yes" : "no");
+    if (checkPorts(planner))
+      return 1;
+
+    // Plan the first device over and over again, until it surely does not fit anymore
+    unsigned int units = phantoms[0]->getRequiredBandwidth();
+    unsigned int copies = ISO_BANDWIDTH_UNITS_MAX / units + 1;
+    BandwidthPlanner reject(BandwidthPlanner::ALL_OR_NOTHING), bestEffort(BandwidthPlanner::BEST_EFFORT);
+    for (unsigned int i = 0; i < copies; i++)
+    {
+      reject.add(phantoms[0]);
+      bestEffort.add(phantoms[0]);
+    }
+
+    if (reject.plan() || reject.getPorts().size() != 1 || reject.getPorts()[0].rejected != copies)
+    {
+      printf("Error: ALL_OR_NOTHING accepted part of a configuration which does not fit...\n");
+      return 1;
+    }
+
+    if (bestEffort.plan() || checkPorts(bestEffort))
+    {
+      printf("Error: BEST_EFFORT accepted a configuration which does not fit...\n");
+      return 1;
+    }
+    const BandwidthPlanner::PortPlan &port = bestEffort.getPorts()[0];
+    if (port.planned != (port.available / units) * units || port.headroom >= units)
+    {
+      printf("Error: BEST_EFFORT did not accept as many devices as possible...\n");
+      return 1;
+    }
+
+    // Downgrading accepts as many devices as fit receiving only, the first ones keep transmitting
+    unsigned int receiveUnits = phantoms[0]->getRequiredBandwidth(Phantom::RECEIVE_ONLY);
+    BandwidthPlanner downgrade(BandwidthPlanner::BEST_EFFORT, true);
+    copies = ISO_BANDWIDTH_UNITS_MAX / receiveUnits + 1;
+    for (unsigned int i = 0; i < copies; i++)
+    {
+      downgrade.add(phantoms[0]);
+    }
+    if (downgrade.plan() || checkPorts(downgrade))
+    {
+      printf("Error: downgrading accepted a configuration which does not fit...\n");
+      return 1;
+    }
+    const BandwidthPlanner::PortPlan &downgraded = downgrade.getPorts()[0];
+    unsigned int accepted = copies - downgraded.rejected, full = 0;
+    for (unsigned int i = 0; i < copies; i++)
+    {
+      const BandwidthPlanner::DevicePlan &device = downgrade.getDevices()[i];
+      if (device.accepted && device.mode == Phantom::FULL)
+      {
+        full++;
+      }
+      if (device.accepted != (i < accepted) || (device.accepted && (device.mode == Phantom::FULL) != (i < full)))
+      {
+        printf("Error: device %u is not planned in the order it was added...\n", i);
+        return 1;
+      }
+    }
+    if (accepted != downgraded.available / receiveUnits || downgraded.downgraded != accepted - full
+        || downgraded.headroom >= units - receiveUnits)
+    {
+      printf("Error: downgrading accepted %u devices (%u transmitting) instead of %u...\n", accepted, full,
+          downgraded.available / receiveUnits);
+      return 1;
+    }
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  while (!phantoms.empty())
+  {
+    delete phantoms.back();
+    phantoms.pop_back();
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the detection of button and dock events
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ButtonEvents.h"
+
+using namespace LibPhantom;
+
+static unsigned int callbacks = 0;
+
+static void countCallback(const PhantomEvent *event, void *userdata)
+{
+  callbacks++;
+}
+
+// Creates a packet with the given (active high) button and dock state
+static void makePacket(unsigned char *packet, bool button1, bool button2, bool docked, uint32_t count0)
+{
+  using namespace PhantomPacketLayout;
+
+  memset(packet, 0, READ_SIZE);
+  unsigned int status = (button1 ? 0 : 1 << BUTTON1.shift) | (button2 ? 0 : 1 << BUTTON2.shift)
+      | (docked ? 0 : 1 << DOCKED.shift);
+  writeLe16(packet + BUTTON1.offset, status);
+  packet[COUNT0.offset] = count0;
+}
+
+static int expect(ButtonEvents &events, PhantomEventType type, uint32_t count0)
+{
+  PhantomEvent event;
+  if (!events.pop(event))
+  {
+    printf("Error: no event while expecting %d...\n", type);
+    return 1;
+  }
+  if (event.type != type || event.count0 != count0)
+  {
+    printf("Error: event %d (packet %u) instead of %d (packet %u)...\n", event.type, event.count0, type, count0);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  ButtonEvents events;
+  PhantomEvent event;
+  unsigned char packet[PhantomPacketLayout::READ_SIZE];
+  uint32_t count0 = 0;
+
+  events.setCallback(countCallback, 0);
+
+  printf("Test 1: initial state gives no events\n");
+  makePacket(packet, false, false, true, count0++);
+  events.received(packet);
+  events.received(packet);
+  if (events.pop(event) || callbacks != 0)
+  {
+    printf("Error: events for the initial state...\n");
+    return 1;
+  }
+  if (!events.isDocked())
+  {
+    printf("Error: not docked...\n");
+    return 1;
+  }
+
+  printf("Test 2: edges\n");
+  makePacket(packet, false, false, false, count0++);
+  events.received(packet);
+  makePacket(packet, true, false, false, count0++);
+  events.received(packet);
+  events.received(packet);
+  makePacket(packet, false, true, false, count0++);
+  events.received(packet);
+  if (expect(events, GIMBAL_UNDOCKED, 1) || expect(events, BUTTON1_PRESSED, 2) || expect(events, BUTTON1_RELEASED, 3)
+      || expect(events, BUTTON2_PRESSED, 3) || events.pop(event))
+    return 1;
+  if (callbacks != 4)
+  {
+    printf("Error: %u callbacks instead of 4...\n", callbacks);
+    return 1;
+  }
+  if (events.isDocked())
+  {
+    printf("Error: still docked...\n");
+    return 1;
+  }
+
+  printf("Test 3: full queue\n");
+  uint32_t first = count0 + 1; // The first packet does not change button 1
+  for (unsigned int i = 0; i <= PHANTOM_EVENT_QUEUE_SIZE + 10; i++)
+  {
+    makePacket(packet, i & 1, true, false, count0++);
+    events.received(packet);
+  }
+  if (events.getDropped() != 10)
+  {
+    printf("Error: %llu events dropped instead of 10...\n", (unsigned long long) events.getDropped());
+    return 1;
+  }
+  if (expect(events, BUTTON1_PRESSED, first))
+    return 1;
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Config ROM images (in host byte order) used to test and benchmark the config ROM decoder
+ *
+ * The images are synthetic: they were composed by hand to follow the layout of the devices they are named after (bus
+ * info block, root directory followed by the leaves and unit directory), with correct CRCs unless stated otherwise. They
+ * are not dumps of real devices, so quirks of actual firmware are not covered.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+namespace ConfigRomCorpus
+{
+  // PHANTOM Omni: vendor name leaf, node unique id leaf and unit directory
+  static const u_int32_t rom_omni[] = {
+    0x040457f9, 0x31333934, 0x0083a002, 0x000b9900, 0x0ed8a683, 0x00059827,
+    0x03000b99, 0x81000004, 0x0c0083c0, 0x8d00000b, 0xd100000d, 0x0008c002,
+    0x00000000, 0x00000000, 0x53656e73, 0x41626c65, 0x20546563, 0x686e6f6c,
+    0x6f676965, 0x73000000, 0x00023508, 0x00000b99, 0x0ed8a683, 0x0003e195,
+    0x12000b99, 0x13000001, 0x17000001,
+  };
+  // Linux OHCI host controller: vendor and model name leaves, node unique id leaf
+  static const u_int32_t rom_ohci[] = {
+    0x04041261, 0x31333934, 0xf000a222, 0x001f1100, 0x12345678, 0x00062f7c,
+    0x03001f11, 0x81000005, 0x17023901, 0x8100000a, 0x0c0083c0, 0x8d00000c,
+    0x00064cb7, 0x00000000, 0x00000000, 0x4c696e75, 0x78204669, 0x72657769,
+    0x72650000, 0x0003ff1c, 0x00000000, 0x00000000, 0x4a756a75, 0x0002569a,
+    0x001f1100, 0x12345678,
+  };
+  // Root directory with more than 16 entries, the entries of interest are at the end
+  static const u_int32_t rom_many_entries[] = {
+    0x0404fa13, 0x31333934, 0x00ff2002, 0x00a0b001, 0x00000002, 0x001658ef,
+    0x38000000, 0x39000001, 0x3a000002, 0x3b000003, 0x3c000004, 0x3d000005,
+    0x3e000006, 0x3f000007, 0x40000008, 0x41000009, 0x4200000a, 0x4300000b,
+    0x4400000c, 0x4500000d, 0x4600000e, 0x4700000f, 0x48000010, 0x49000011,
+    0x4a000012, 0x4b000013, 0x0300a0b0, 0x1700beef,
+  };
+  // PHANTOM Omni image with a corrupted node capabilities entry (root directory CRC mismatch)
+  static const u_int32_t rom_bad_crc[] = {
+    0x040457f9, 0x31333934, 0x0083a002, 0x000b9900, 0x0ed8a683, 0x00059827,
+    0x03000b99, 0x81000004, 0x0c0082c0, 0x8d00000b, 0xd100000d, 0x0008c002,
+    0x00000000, 0x00000000, 0x53656e73, 0x41626c65, 0x20546563, 0x686e6f6c,
+    0x6f676965, 0x73000000, 0x00023508, 0x00000b99, 0x0ed8a683, 0x0003e195,
+    0x12000b99, 0x13000001, 0x17000001,
+  };
+  // Minimal config ROM: only the vendor id
+  static const u_int32_t rom_minimal[] = {
+    0x01000b99,
+  };
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the config ROM decoder (no firewire devices are required)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "ConfigRom.h"
+#include "config_rom_corpus.h"
+
+#define FUZZ_ITERATIONS 100000
+
+using namespace LibPhantom;
+using namespace ConfigRomCorpus;
+
+/**
+ * Decodes the image the same way FirewireDevice does: only fetch the quadlets the decoder asks for
+ *
+ * @return the number of fetches, or -1 when the image is invalid
+ */
+static int decodeIncremental(const u_int32_t *image, unsigned int length, struct config_rom *crom)
+{
+  u_int32_t buffer[CONFIG_ROM_QUADLETS];
+  unsigned int available = 0, needed = 1;
+  int fetches = 0;
+
+  while (needed > available)
+  {
+    if (needed > length)
+    {
+      return -1;
+    }
+    memcpy(buffer + available, image + available, (needed - available) * 4);
+    available = needed;
+    fetches++;
+
+    needed = decodeConfigRom(buffer, available, crom);
+    if (needed == 0)
+    {
+      return -1;
+    }
+  }
+  return fetches;
+}
+
+/**
+ * Simple (deterministic) pseudo random generator
+ */
+static u_int32_t random_state = 12345;
+static u_int32_t nextRandom()
+{
+  random_state = random_state * 1103515245 + 12345;
+  return random_state >> 8;
+}
+
+int main()
+{
+  struct config_rom crom, crom2;
+  int fetches;
+
+  printf("Test 1: PHANTOM Omni image\n");
+  fetches = decodeIncremental(rom_omni, sizeof(rom_omni) / 4, &crom);
+  if (fetches < 0 || !crom.crc_valid || crom.vendor_id != 0x000b99 || strcmp(crom.vendor, "SensAble Technologies") != 0
+      || crom.node_unique_id != 0x00000b990ed8a683ULL || crom.unit_spec_id != 0x000b99 || crom.unit_sw_version != 1
+      || crom.model_id != 1 || crom.guid_lo != 0x0ed8a683 || crom.node_capabilities != 0x0083c0)
+  {
+    printf("Decoded unexpected values\n");
+    return 1;
+  }
+  printf("Decoded in %d block reads\n", fetches);
+
+  printf("Test 2: host controller image\n");
+  if (decodeIncremental(rom_ohci, sizeof(rom_ohci) / 4, &crom) < 0 || !crom.crc_valid
+      || strcmp(crom.vendor, "Linux Firewire") != 0 || crom.model_id != 0x023901
+      || crom.node_unique_id != 0x001f110012345678ULL || !crom.irm_cap || crom.link_speed != 2)
+  {
+    printf("Decoded unexpected values\n");
+    return 1;
+  }
+
+  printf("Test 3: root directory with more than 16 entries\n");
+  if (decodeIncremental(rom_many_entries, sizeof(rom_many_entries) / 4, &crom) < 0 || crom.model_id != 0x00beef)
+  {
+    printf("Entries after the 16th entry were not decoded\n");
+    return 1;
+  }
+
+  printf("Test 4: CRC mismatch\n");
+  if (decodeIncremental(rom_bad_crc, sizeof(rom_bad_crc) / 4, &crom) < 0 || crom.crc_valid)
+  {
+    printf("CRC mismatch was not detected\n");
+    return 1;
+  }
+
+  printf("Test 5: minimal config ROM\n");
+  if (decodeIncremental(rom_minimal, sizeof(rom_minimal) / 4, &crom) != 1 || crom.vendor_id != 0x000b99)
+  {
+    printf("Decoded unexpected values\n");
+    return 1;
+  }
+
+  printf("Test 6: decoding mutated images\n");
+  const u_int32_t *images[] = { rom_omni, rom_ohci, rom_many_entries };
+  const unsigned int lengths[] = { sizeof(rom_omni) / 4, sizeof(rom_ohci) / 4, sizeof(rom_many_entries) / 4 };
+  for (unsigned int i = 0; i < FUZZ_ITERATIONS; i++)
+  {
+    u_int32_t image[CONFIG_ROM_QUADLETS];
+    unsigned int length = lengths[i % 3];
+    memcpy(image, images[i % 3], length * 4);
+
+    // Either flip some bits or use random data after a valid header
+    if (i % 8 == 7)
+    {
+      length = 1 + nextRandom() % CONFIG_ROM_QUADLETS;
+      for (unsigned int j = 1; j < length; j++)
+      {
+        image[j] = nextRandom() ^ nextRandom() << 16;
+      }
+    }
+    else
+    {
+      for (unsigned int flips = 1 + nextRandom() % 4; flips > 0; flips--)
+      {
+        image[nextRandom() % length] ^= 1 << (nextRandom() % 32);
+      }
+    }
+
+    // Decoding may fail, but should never need more than the config ROM and both ways should give the same result
+    unsigned int needed = decodeConfigRom(image, length, &crom);
+    if (needed > CONFIG_ROM_QUADLETS || memchr(crom.vendor, 0, sizeof(crom.vendor)) == 0)
+    {
+      printf("Mutated image %u decoded to an invalid result\n", i);
+      return 1;
+    }
+    fetches = decodeIncremental(image, length, &crom2);
+    if ((fetches >= 0) != (needed != 0 && needed <= length) || (fetches >= 0 && memcmp(&crom, &crom2, sizeof(crom)) != 0))
+    {
+      printf("Mutated image %u decoded differently when fetched incrementally\n", i);
+      return 1;
+    }
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test awaiting samples and cycles in coroutines
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PhantomCoroutine.h"
+
+using namespace LibPhantom;
+
+// Count the heap allocations, resuming the coroutines should not allocate
+static unsigned int allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size);
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+static unsigned short encoders[3];
+static u_int64_t resumedCycle;
+
+static PhantomTask readSamples(Phantom *phantom)
+{
+  int16_t force[3] = { 0, 0, 0 };
+
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    PhantomState state = co_await phantom->nextSample();
+    encoders[i] = state.encoder[0];
+    force[0] = i;
+    phantom->setForces(force);
+  }
+}
+
+static PhantomTask waitCycles(Phantom *phantom, unsigned int cycles)
+{
+  resumedCycle = co_await phantom->nextCycle(cycles);
+}
+
+int main()
+{
+  try
+  {
+    Phantom *p = Phantom::findPhantom();
+    if (p == 0)
+    {
+      printf("Error: could not find a Phantom...\n");
+      return 1;
+    }
+    p->startPhantom();
+
+    printf("Test 1: awaiting samples and cycles\n");
+    PhantomTask samples = readSamples(p);
+    PhantomTask cycles = waitCycles(p, 5);
+    PhantomTask never = waitCycles(p, 100);
+    if (samples.done() || cycles.done())
+    {
+      printf("Error: tasks did not wait...\n");
+      return 1;
+    }
+
+    unsigned int before = allocations;
+    for (unsigned int i = 0; i < 10; i++)
+    {
+      p->isoIterate();
+    }
+    if (!samples.done() || !cycles.done() || never.done())
+    {
+      printf("Error: tasks are not resumed when expected...\n");
+      return 1;
+    }
+    if (encoders[1] != encoders[0] + 1 || encoders[2] != encoders[1] + 1)
+    {
+      printf("Error: samples %hu %hu %hu are not consecutive...\n", encoders[0], encoders[1], encoders[2]);
+      return 1;
+    }
+    if (resumedCycle != 5)
+    {
+      printf("Error: resumed in cycle %llu instead of 5...\n", (unsigned long long) resumedCycle);
+      return 1;
+    }
+
+    printf("Test 2: resuming does not allocate\n");
+    if (allocations != before)
+    {
+      printf("Error: %u allocations while iterating...\n", allocations - before);
+      return 1;
+    }
+
+    printf("Test 3: destroying a suspended task\n");
+    {
+      PhantomTask destroyed = waitCycles(p, 1);
+    }
+    p->isoIterate();
+
+    p->stopPhantom();
+    delete p;
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
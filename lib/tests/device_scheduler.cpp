@@ -0,0 +1,118 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the scheduling of several devices on one thread
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "DeviceScheduler.h"
+#include "Phantom.h"
+
+using namespace LibPhantom;
+
+static unsigned int callbacks[2];
+
+static void countCallback(Phantom *phantom, void *userdata)
+{
+  callbacks[(long) userdata]++;
+}
+
+int main()
+{
+  PhantomList phantoms;
+
+  try
+  {
+    phantoms = Phantom::findAll();
+    if (phantoms.size() < 2)
+    {
+      printf("Error: this test needs two Phantoms...\n");
+      return 1;
+    }
+
+    DeviceScheduler scheduler(1);
+    PhantomSlackStatistics s[2];
+
+    bool rejected = false;
+    try
+    {
+      scheduler.add(phantoms[0], 0);
+    }
+    catch (char const* str)
+    {
+      rejected = true;
+    }
+    if (!rejected)
+    {
+      printf("Error: a rate of 0 was accepted...\n");
+      return 1;
+    }
+
+    phantoms[0]->startPhantom();
+    phantoms[1]->startPhantom();
+    scheduler.add(phantoms[0], 1000, countCallback, (void *) 0);
+    scheduler.add(phantoms[1], 500, countCallback, (void *) 1);
+    scheduler.start();
+    usleep(200000);
+    scheduler.stop();
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+      scheduler.getSlack(i, s[i]);
+      printf("Device %u: %llu cycles, %llu misses, %llu skipped, slack %.1f us (min %.1f us)\n", i,
+          (unsigned long long) s[i].cycles, (unsigned long long) s[i].misses, (unsigned long long) s[i].skipped,
+          s[i].meanSlack * 1e6, s[i].minSlack * 1e6);
+      if (callbacks[i] != s[i].cycles)
+      {
+        printf("Error: %u callbacks for %llu cycles...\n", callbacks[i], (unsigned long long) s[i].cycles);
+        return 1;
+      }
+    }
+
+    if (s[0].cycles < 100 || s[0].cycles > 250 || s[1].cycles < 50 || s[1].cycles > 125)
+    {
+      printf("Error: expected about 200 and 100 cycles...\n");
+      return 1;
+    }
+    if (s[0].meanSlack <= 0 || s[1].meanSlack <= s[0].meanSlack)
+    {
+      printf("Error: the slack should be positive and larger for the slower device...\n");
+      return 1;
+    }
+    if (scheduler.getError())
+    {
+      printf("Error: %s\n", scheduler.getError());
+      return 1;
+    }
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  for (PhantomList::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+  {
+    delete *it;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
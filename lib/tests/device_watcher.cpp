@@ -0,0 +1,217 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the notifications of the DeviceWatcher, using a fake bus on which nodes get added and removed
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <set>
+
+#include "DeviceIterator.h"
+#include "DeviceWatcher.h"
+
+using namespace LibPhantom;
+
+// Guids of the nodes which are currently on the fake bus
+static std::set<u_int64_t> bus;
+
+class FakeProbe : public DeviceProbe
+{
+public:
+  FakeProbe(u_int64_t guid) :
+    DeviceProbe(configRomBuffer)
+  {
+    memset(&configRom, 0, sizeof(configRom));
+    configRom.guid_hi = guid >> 32;
+    configRom.guid_lo = guid;
+    configRom.vendor_id = 0x000b99;
+    configRomRead = true;
+    configRomValid = true;
+  }
+
+  void read(u_int64_t address, char *buffer, unsigned int length)
+  {
+    throw "Fake node has no memory";
+  }
+
+private:
+  u_int32_t configRomBuffer[CONFIG_ROM_QUADLETS];
+};
+
+class FakeIterator : public DeviceIterator
+{
+public:
+  FakeIterator() :
+    it(bus.begin())
+  {
+  }
+
+  ~FakeIterator()
+  {
+    for (unsigned int i = 0; i < probes.size(); i++)
+    {
+      delete probes[i];
+    }
+  }
+
+  FirewireDevice* next()
+  {
+    return 0;
+  }
+
+  DeviceProbe* nextProbe()
+  {
+    if (it == bus.end())
+    {
+      return 0;
+    }
+    probes.push_back(new FakeProbe(*it++));
+    return probes.back();
+  }
+
+private:
+  std::set<u_int64_t>::iterator it;
+  std::vector<FakeProbe*> probes;
+};
+
+class FakeWatcher : public DeviceWatcher
+{
+public:
+  int getFd()
+  {
+    return -1;
+  }
+
+  void process()
+  {
+    rescan();
+  }
+
+protected:
+  DeviceIterator* createIterator()
+  {
+    return new FakeIterator;
+  }
+};
+
+struct Counts
+{
+  int added;
+  int removed;
+  u_int64_t last;
+};
+
+static void count(DeviceWatcherEvent event, const WatchedDevice &device, void *userdata)
+{
+  Counts *c = (Counts *) userdata;
+  if (event == DEVICE_ADDED)
+    c->added++;
+  else
+    c->removed++;
+  c->last = device.guid & 0xffffffffffULL;
+}
+
+static DeviceWatcher *watcher;
+
+// Unsubscribes itself on its first notification
+static void once(DeviceWatcherEvent event, const WatchedDevice &device, void *userdata)
+{
+  count(event, device, userdata);
+  watcher->unsubscribe(once, userdata);
+}
+
+static Counts victim;
+
+// Unsubscribes the victim, which is subscribed after this one
+static void killer(DeviceWatcherEvent event, const WatchedDevice &device, void *userdata)
+{
+  count(event, device, userdata);
+  watcher->unsubscribe(count, &victim);
+}
+
+static bool check(const char *name, Counts &c, int added, int removed)
+{
+  if (c.added != added || c.removed != removed)
+  {
+    printf("Error: %s got %d added and %d removed, expected %d and %d\n", name, c.added, c.removed, added, removed);
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  FakeWatcher w;
+  watcher = &w;
+  Counts all = { 0, 0, 0 };
+  Counts first = { 0, 0, 0 };
+  Counts k = { 0, 0, 0 };
+
+  printf("Test 1: nodes present when subscribing\n");
+  bus.insert(1);
+  bus.insert(2);
+  w.process();
+  w.subscribe(count, &all);
+  if (!check("subscriber", all, 2, 0))
+    return 1;
+
+  printf("Test 2: node added and removed\n");
+  bus.erase(1);
+  bus.insert(3);
+  w.process();
+  if (!check("subscriber", all, 3, 1))
+    return 1;
+  if (w.getDevices().size() != 2)
+  {
+    printf("Error: %d devices known, expected 2\n", (int) w.getDevices().size());
+    return 1;
+  }
+
+  printf("Test 3: nothing changed\n");
+  w.process();
+  if (!check("subscriber", all, 3, 1))
+    return 1;
+
+  printf("Test 4: unsubscribing from within a callback\n");
+  w.unsubscribe(count, &all);
+  all.added = all.removed = 0;
+  w.process();
+  w.subscribe(once, &first);
+  w.subscribe(count, &all);
+  if (!check("self-removing subscriber", first, 1, 0) || !check("subscriber", all, 2, 0))
+    return 1;
+  bus.insert(4);
+  w.process();
+  if (!check("self-removing subscriber", first, 1, 0) || !check("subscriber", all, 3, 0) || all.last != 4)
+    return 1;
+
+  printf("Test 5: unsubscribing another subscriber from within a callback\n");
+  w.subscribe(killer, &k);
+  victim.added = victim.removed = 0;
+  w.subscribe(count, &victim);
+  all.added = k.added = victim.added = 0;
+  bus.insert(5);
+  bus.erase(2);
+  w.process();
+  if (!check("subscriber", all, 1, 1) || !check("killer", k, 1, 1) || !check("removed subscriber", victim, 0, 0))
+    return 1;
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
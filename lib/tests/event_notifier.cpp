@@ -0,0 +1,171 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test waiting for new samples with poll()
+ */
+
+#include <stdio.h>
+#include <poll.h>
+#include <atomic>
+#include <thread>
+
+#include "Phantom.h"
+
+using namespace LibPhantom;
+
+static bool readable(int fd, int timeout = 0)
+{
+  struct pollfd p;
+  p.fd = fd;
+  p.events = POLLIN;
+  return poll(&p, 1, timeout) == 1 && (p.revents & POLLIN);
+}
+
+#define RACE_SIGNALS 20000000
+
+/**
+ * Lets a thread signal while the consumer clears the notifier, the consumer must keep getting woken up until it saw the
+ * last signal
+ */
+static bool raceSignalAndClear()
+{
+  EventNotifier notifier;
+  std::atomic<int> sequence(0);
+  std::atomic<bool> done(false);
+
+  std::thread producer([&]()
+  {
+    for (int i = 1; i <= RACE_SIGNALS; i++)
+    {
+      sequence.store(i, std::memory_order_seq_cst);
+      notifier.signal();
+    }
+    done = true;
+  });
+
+  // Clear as soon as the notifier becomes readable, to hit the window between a signal() and clear() as often as possible
+  int seen = 0;
+  while (!done)
+  {
+    if (readable(notifier.getFd()))
+    {
+      notifier.clear();
+      seen = sequence.load(std::memory_order_seq_cst);
+    }
+  }
+  producer.join();
+
+  // Unless the consumer saw the last signal already, the notifier must still be readable
+  if (seen < RACE_SIGNALS && !readable(notifier.getFd(), 1000))
+  {
+    printf("Error: wakeup lost after signal %d of %d...\n", seen, RACE_SIGNALS);
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  PhantomList phantoms;
+
+  try
+  {
+    phantoms = Phantom::findAll();
+    if (phantoms.size() < 2)
+    {
+      printf("Error: this test needs two Phantoms...\n");
+      return 1;
+    }
+    Phantom *p = phantoms[0];
+    p->startPhantom();
+
+    printf("Test 1: signalled by new samples\n");
+    int fd = p->getNotifier()->getFd();
+    if (readable(fd))
+    {
+      printf("Error: readable before any sample is received...\n");
+      return 1;
+    }
+    p->isoIterate();
+    p->isoIterate();
+    if (!readable(fd))
+    {
+      printf("Error: not readable after receiving samples...\n");
+      return 1;
+    }
+
+    printf("Test 2: cleared by the consumer\n");
+    p->getNotifier()->clear();
+    if (readable(fd))
+    {
+      printf("Error: still readable after clear()...\n");
+      return 1;
+    }
+    p->isoIterate();
+    if (!readable(fd))
+    {
+      printf("Error: not signalled again after clear()...\n");
+      return 1;
+    }
+
+    printf("Test 3: one notifier for a group of devices\n");
+    EventNotifier group;
+    phantoms[1]->startPhantom();
+    phantoms[0]->setNotifier(&group);
+    phantoms[1]->setNotifier(&group);
+    if (readable(group.getFd()))
+    {
+      printf("Error: group readable before any sample is received...\n");
+      return 1;
+    }
+    phantoms[1]->isoIterate();
+    if (!readable(group.getFd()))
+    {
+      printf("Error: group not signalled by the second device...\n");
+      return 1;
+    }
+    group.clear();
+    phantoms[0]->isoIterate();
+    if (!readable(group.getFd()))
+    {
+      printf("Error: group not signalled by the first device...\n");
+      return 1;
+    }
+    phantoms[0]->setNotifier(0);
+    phantoms[1]->setNotifier(0);
+
+    printf("Test 4: signal() racing with clear()\n");
+    if (!raceSignalAndClear())
+    {
+      return 1;
+    }
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  for (PhantomList::iterator it = phantoms.begin(); it != phantoms.end(); it++)
+  {
+    delete *it;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
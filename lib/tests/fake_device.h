@@ -0,0 +1,144 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Device and communication without hardware for the tests and benchmarks of the isochronous path
+ */
+
+#pragma once
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Communication.h"
+#include "FirewireDevice.h"
+
+/**
+ * Communication without a device: emulates the configuration registers PhantomIsoChannel uses. A test or benchmark either
+ * calls the isochronous handlers directly (like the isochronous handler of libraw1394 does), or sets fd to a pipe from
+ * which the iterations read the packets (like libraw1394 reads the events of the kernel). The interrupt interval is only
+ * recorded, restarts counts how often it changed (which restarts the receive context of libraw1394).
+ */
+class FakeCommunication : public LibPhantom::Communication
+{
+public:
+  FakeCommunication() :
+    fd(-1), irqInterval(1), restarts(0)
+  {
+    memset(memory, 0, sizeof(memory));
+    memory[0x83] = 0xc0;
+  }
+
+  void read(u_int64_t address, char *buffer, unsigned int length)
+  {
+    if (address >= 0x1000 && address + length <= 0x1100)
+      memcpy(buffer, &memory[address - 0x1000], length);
+    else
+      memset(buffer, 0, length);
+  }
+
+  void write(u_int64_t address, char *buffer, unsigned int length)
+  {
+    if (address >= 0x1000 && address + length <= 0x1100)
+      memcpy(&memory[address - 0x1000], buffer, length);
+  }
+
+  void stopIsoTransfer()
+  {
+  }
+
+  void doIterate()
+  {
+    if (fd >= 0)
+    {
+      unsigned char packet[64];
+      if (::read(fd, packet, PACKET_SIZE) == PACKET_SIZE)
+      {
+        callbackRecvHandler(packet, PACKET_SIZE);
+      }
+    }
+  }
+
+  bool pollIterate()
+  {
+    struct pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    if (fd < 0 || poll(&p, 1, 0) != 1)
+    {
+      return false;
+    }
+    doIterate();
+    return true;
+  }
+
+  void setIrqInterval(unsigned int packets)
+  {
+    if (packets != irqInterval)
+    {
+      irqInterval = packets;
+      restarts++;
+    }
+  }
+
+  static const int PACKET_SIZE = 48;
+
+  unsigned char memory[0x100];
+  int fd;
+  unsigned int irqInterval;
+  unsigned int restarts;
+};
+
+class FakeDevice : public LibPhantom::FirewireDevice
+{
+public:
+  FakeDevice() :
+    iso(0)
+  {
+    com = new FakeCommunication();
+  }
+
+  ~FakeDevice()
+  {
+    delete com;
+  }
+
+  LibPhantom::Communication *createCommunication()
+  {
+    // The first one created by PhantomIsoChannel is used for the isochronous transfer
+    FakeCommunication *c = new FakeCommunication();
+    if (!iso)
+      iso = c;
+    return c;
+  }
+
+  unsigned int getFreeChannel()
+  {
+    return 0;
+  }
+
+  void claimChannel(unsigned int channel)
+  {
+  }
+
+  void releaseChannel(unsigned int channel)
+  {
+  }
+
+  FakeCommunication *iso;
+};
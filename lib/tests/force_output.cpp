@@ -0,0 +1,135 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the stale policies of ForceOutput
+ */
+
+#include <stdio.h>
+
+#include "ForceOutput.h"
+#include "PhantomPacket.h"
+
+using namespace LibPhantom;
+using namespace PhantomPacketLayout;
+
+static int expect(const char *name, int value, int expected)
+{
+  if (value != expected)
+  {
+    printf("Error: %s is %d instead of %d...\n", name, value, expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  ForceOutput output;
+  PhantomForceStatistics s;
+  uint16_t force[3], status;
+  int16_t a[3] = { 100, -100, 0 }, b[3] = { 200, -200, 0 };
+
+  printf("Test 1: no forces set\n");
+  status = output.evaluate(1.0, force);
+  if (expect("status", status, STATUS_DEFAULT) || expect("force", force[0], FORCE_NONE) || expect("idle",
+      output.isIdle(), true))
+    return 1;
+
+  printf("Test 2: forces in time\n");
+  output.set(a, true, 1.000);
+  output.set(b, true, 1.001);
+  status = output.evaluate(1.002, force);
+  if (expect("status", status, STATUS_DEFAULT | STATUS_MOTORS_ON) || expect("force x", force[0], FORCE_NONE + 200)
+      || expect("force y", force[1], FORCE_NONE - 200) || expect("idle", output.isIdle(), false))
+    return 1;
+
+  printf("Test 3: hold\n");
+  output.setStalePolicy(ForceOutput::HOLD, 0.002, 0.01);
+  status = output.evaluate(1.005, force);
+  if (expect("status", status, STATUS_DEFAULT | STATUS_MOTORS_ON) || expect("force x", force[0], FORCE_NONE + 200))
+    return 1;
+
+  printf("Test 4: extrapolate\n");
+  output.setStalePolicy(ForceOutput::EXTRAPOLATE, 0.002, 0.003);
+  output.evaluate(1.004, force); // 3 ms after the last forces
+  if (expect("force x", force[0], FORCE_NONE + 500) || expect("force y", force[1], FORCE_NONE - 500))
+    return 1;
+  output.evaluate(1.100, force); // Limited to the horizon
+  if (expect("force x", force[0], FORCE_NONE + 700) || expect("force z", force[2], FORCE_NONE))
+    return 1;
+
+  printf("Test 5: decay\n");
+  output.setStalePolicy(ForceOutput::DECAY, 0.002, 0.01);
+  output.evaluate(1.0035, force);
+  if (expect("force x", force[0], FORCE_NONE + 190))
+    return 1;
+  output.evaluate(1.013, force); // One time constant
+  if (expect("force x", force[0], FORCE_NONE + 74))
+    return 1;
+  output.evaluate(2.0, force);
+  if (expect("force x", force[0], FORCE_NONE))
+    return 1;
+
+  printf("Test 6: motors off\n");
+  output.setStalePolicy(ForceOutput::MOTORS_OFF, 0.002);
+  status = output.evaluate(2.001, force);
+  if (expect("status", status, STATUS_DEFAULT) || expect("force x", force[0], FORCE_NONE))
+    return 1;
+
+  printf("Test 7: statistics\n");
+  output.set(a, true, 2.002);
+  output.evaluate(2.002, force);
+  output.getStatistics(s);
+  if (expect("misses", s.misses, 7) || expect("periods", s.missPeriods, 1))
+    return 1;
+  if (s.missTime < 0.9989 || s.missTime > 0.9991 || s.longestMiss != s.missTime)
+  {
+    printf("Error: miss time is %f (longest %f) instead of 0.999\n", s.missTime, s.longestMiss);
+    return 1;
+  }
+  output.evaluate(2.010, force);
+  output.set(b, true, 2.011);
+  output.evaluate(2.011, force);
+  output.getStatistics(s);
+  if (expect("periods", s.missPeriods, 2))
+    return 1;
+  if (s.missTime < 1.0059 || s.missTime > 1.0061 || s.longestMiss > 0.9991)
+  {
+    printf("Error: miss time is %f (longest %f) instead of 1.006\n", s.missTime, s.longestMiss);
+    return 1;
+  }
+
+  printf("Test 8: extreme forces are clamped\n");
+  int16_t big[3] = { 30000, -30000, 0 };
+  output.set(big, true, 3.0);
+  output.evaluate(3.0, force);
+  if (expect("force x", force[0], FORCE_MAX) || expect("force y", force[1], 0))
+    return 1;
+
+  printf("Test 9: idle without forces\n");
+  int16_t zero[3] = { 0, 0, 0 };
+  output.set(zero, true, 4.0);
+  if (expect("idle", output.isIdle(), true))
+    return 1;
+  output.set(a, false, 4.1);
+  if (expect("idle", output.isIdle(), true))
+    return 1;
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the idle mode of a device: entering it while docked without forces, suppressing unchanged
+ * samples and leaving it on undocking or new forces
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "DeviceIterator.h"
+#include "Phantom.h"
+#include "PhantomPacket.h"
+#include "fake_device.h"
+
+using namespace LibPhantom;
+
+/**
+ * Gives access to the protected constructor and the receive channel
+ */
+class TestPhantom : public Phantom
+{
+public:
+  TestPhantom(FirewireDevice *fw) :
+    Phantom(fw, 0)
+  {
+  }
+
+  using Phantom::recv_channel;
+};
+
+static uint32_t count0 = 0;
+
+/**
+ * Lets the fake device receive a packet and does the receive stage of an iteration
+ */
+static void receive(FakeDevice *device, Phantom *p, bool docked, uint16_t encoder)
+{
+  unsigned char packet[FakeCommunication::PACKET_SIZE];
+  memset(packet, 0, sizeof(packet));
+  writeField(packet, PhantomPacketLayout::ENCODER_X, encoder);
+  writeField(packet, PhantomPacketLayout::BUTTON1, 1);
+  writeField(packet, PhantomPacketLayout::BUTTON2, 1);
+  writeField(packet, PhantomPacketLayout::DOCKED, docked ? 0 : 1);
+  count0++;
+  memcpy(packet + PhantomPacketLayout::COUNT0.offset, &count0, 4);
+  device->iso->callbackRecvHandler(packet, sizeof(packet));
+  p->isoReceive();
+}
+
+static bool expectIdle(FakeDevice *device, Phantom *p, bool idle, const char *when)
+{
+  unsigned int interval = idle ? 20 : 1;
+  if (p->isIdle() != idle || device->iso->irqInterval != interval)
+  {
+    printf("Error: %s idle (interrupt every %u packets) %s...\n", p->isIdle() ? "still" : "not", device->iso->irqInterval,
+        when);
+    return false;
+  }
+  return true;
+}
+
+static u_int64_t samples(Phantom *p)
+{
+  PhantomState state;
+  return p->getState(state);
+}
+
+int main()
+{
+  try
+  {
+    FakeDevice *device = new FakeDevice();
+    TestPhantom *p = new TestPhantom(device);
+    const int16_t force[3] = { 100, 0, 0 };
+    const int16_t none[3] = { 0, 0, 0 };
+
+    printf("Test 1: entering the idle mode when docked\n");
+    p->setIdlePolicy(true, 0.02);
+    p->startPhantom(Phantom::RECEIVE_ONLY);
+    receive(device, p, false, 1);
+    if (!expectIdle(device, p, false, "while undocked"))
+      return 1;
+    receive(device, p, true, 1);
+    if (!expectIdle(device, p, true, "after docking") || device->iso->restarts != 1)
+      return 1;
+
+    printf("Test 2: unchanged samples are suppressed while idle\n");
+    receive(device, p, true, 1);
+    u_int64_t before = samples(p);
+    for (int i = 0; i < 10; i++)
+    {
+      receive(device, p, true, 1);
+    }
+    if (samples(p) != before)
+    {
+      printf("Error: %llu unchanged samples stored while idle...\n", (unsigned long long) (samples(p) - before));
+      return 1;
+    }
+    receive(device, p, true, 2);
+    if (samples(p) != before + 1)
+    {
+      printf("Error: changed sample not stored while idle...\n");
+      return 1;
+    }
+
+    printf("Test 3: leaving the idle mode for new forces\n");
+    p->setForces(force);
+    receive(device, p, true, 2);
+    if (!expectIdle(device, p, false, "with forces"))
+      return 1;
+    before = samples(p);
+    receive(device, p, true, 2);
+    if (samples(p) != before + 1)
+    {
+      printf("Error: unchanged sample suppressed while not idle...\n");
+      return 1;
+    }
+    p->setForces(none);
+    receive(device, p, true, 2);
+    if (!expectIdle(device, p, true, "without forces"))
+      return 1;
+
+    printf("Test 4: leaving the idle mode when undocked\n");
+    receive(device, p, false, 2);
+    if (!expectIdle(device, p, false, "after undocking") || device->iso->restarts != 4)
+      return 1;
+    p->stopPhantom();
+    delete p;
+
+    printf("Test 5: restarting the receive context of a device\n");
+    DeviceIterator *it = DeviceIterator::createInstance();
+    FirewireDevice *dev;
+    for (dev = it->next(); dev && !dev->isSensableDevice(); dev = it->next())
+    {
+      delete dev;
+    }
+    delete it;
+    if (dev == 0)
+    {
+      printf("Error: could not find a Phantom...\n");
+      return 1;
+    }
+    p = new TestPhantom(dev);
+    p->startPhantom(Phantom::RECEIVE_ONLY);
+    p->isoIterate();
+    p->recv_channel->setIrqInterval(16);
+    before = samples(p);
+    for (int i = 0; i < 32 && samples(p) == before; i++)
+    {
+      p->isoIterate();
+    }
+    p->recv_channel->setIrqInterval(1);
+    if (samples(p) == before)
+    {
+      printf("Error: no packets received after changing the interrupt interval...\n");
+      return 1;
+    }
+    p->stopPhantom();
+    delete p;
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the allocation of isochronous resources at the isochronous resource manager, which uses
+ * compare-swap lock transactions
+ */
+
+#include <stdio.h>
+
+#include "FirewireDevice.h"
+#include "Phantom.h"
+
+using namespace LibPhantom;
+
+int main()
+{
+  try
+  {
+    Phantom *p = Phantom::findPhantom();
+    if (p == 0)
+    {
+      printf("Error: could not find a Phantom...\n");
+      return 1;
+    }
+    FirewireDevice *d = p->getFirewireDevice();
+
+    printf("Test 1: allocating and releasing bandwidth\n");
+    unsigned int available = d->getAvailableBandwidth();
+    d->allocateBandwidth(100);
+    if (d->getAvailableBandwidth() != available - 100)
+    {
+      printf("Error: %u units available after allocating 100 of %u...\n", d->getAvailableBandwidth(), available);
+      return 1;
+    }
+    d->releaseBandwidth(100);
+    if (d->getAvailableBandwidth() != available)
+    {
+      printf("Error: %u units available after releasing, expected %u...\n", d->getAvailableBandwidth(), available);
+      return 1;
+    }
+
+    printf("Test 2: allocating and releasing channels\n");
+    unsigned int first = d->allocateChannel();
+    unsigned int second = d->allocateChannel();
+    if (first == second || d->getFreeChannel() == first || d->getFreeChannel() == second)
+    {
+      printf("Error: channel %u or %u was allocated twice...\n", first, second);
+      return 1;
+    }
+    d->releaseChannel(second);
+    d->releaseChannel(first);
+    if (d->getFreeChannel() > first)
+    {
+      printf("Error: channel %u is not free after releasing it...\n", first);
+      return 1;
+    }
+
+    printf("Test 3: claiming a claimed channel\n");
+    d->claimChannel(first);
+    bool failed = false;
+    try
+    {
+      d->claimChannel(first);
+    }
+    catch (char const* str)
+    {
+      failed = true;
+    }
+    d->releaseChannel(first);
+    if (!failed)
+    {
+      printf("Error: channel %u was claimed twice...\n", first);
+      return 1;
+    }
+
+    delete p;
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -24,11 +24,90 @@
 #include "Communication.h"
 #include "DeviceIterator.h"
 #include "Phantom.h"
+#include "PhantomSpec.h"
 
-int main()
+using namespace LibPhantom;
+
+static unsigned int packets_received = 0;
+static unsigned short last_encoder_x;
+
+static void printData(const PhantomDataRead *d, void *userdata)
+{
+  packets_received++;
+  last_encoder_x = d->encoder_x;
+  printf("Encoder      X %6hd Y %6hd Z %6hd\n", d->encoder_x, d->encoder_y, d->encoder_z);
+  printf("Gimbal       X %6hd Y %6hd Z %6hd\n", d->gimbal.x, d->gimbal.y, d->gimbal.z);
+  printf("Gimbal (inv) X %6hu Y %6hu Z %6hu\n", d->gimbal_inv.x, d->gimbal_inv.y, d->gimbal_inv.z);
+  if (d->status.button1 == 0)
+    printf("Button1 pressed\n");
+  if (d->status.button2 == 0)
+    printf("Button2 pressed\n");
+  if (d->status.docked == 0)
+    printf("Gimbal docked\n");
+}
+
+/**
+ * @return true if the isochronous data transfer is enabled in the control register of the device
+ */
+static bool isoEnabled(BaseDevice *device)
+{
+  unsigned char control;
+  device->getFirewireDevice()->read(ADDR_CONTROL, (char *) &control, 1);
+  return control & ADDR_CONTROL_enable_iso;
+}
+
+static bool expectIsoEnabled(BaseDevice *device, bool expected, const char *when)
 {
-  using namespace LibPhantom;
+  if (isoEnabled(device) != expected)
+  {
+    printf("Error: isochronous data transfer is %s %s...\n", expected ? "disabled" : "enabled", when);
+    return false;
+  }
+  return true;
+}
 
+/**
+ * Gives access to the channel refcounting of Phantom, so the channels can be started and stopped in any order
+ */
+class ChannelPhantom : public Phantom
+{
+public:
+  ChannelPhantom(FirewireDevice *fw) :
+    Phantom(fw, 0)
+  {
+  }
+
+  using Phantom::startChannel;
+  using Phantom::stopChannel;
+};
+
+/**
+ * Starts both channels and stops them again in the given orders, the device must only be disabled after the last stop
+ */
+static bool checkChannelOrder(ChannelPhantom *p, bool receiveFirst, bool stopReceiveFirst)
+{
+  PhantomIsoChannel recv(p->getFirewireDevice(), true);
+  PhantomIsoChannel xmit(p->getFirewireDevice(), false);
+  PhantomIsoChannel *first = receiveFirst ? &recv : &xmit, *second = receiveFirst ? &xmit : &recv;
+
+  p->startChannel(first);
+  if (!expectIsoEnabled(p, true, "after starting the first channel"))
+    return false;
+  p->startChannel(second);
+  if (!expectIsoEnabled(p, true, "after starting the second channel"))
+    return false;
+
+  first = stopReceiveFirst ? &recv : &xmit;
+  second = stopReceiveFirst ? &xmit : &recv;
+  p->stopChannel(first);
+  if (!expectIsoEnabled(p, true, "while one channel is still running"))
+    return false;
+  p->stopChannel(second);
+  return expectIsoEnabled(p, false, "after stopping the last channel");
+}
+
+int main()
+{
   try
   {
     // These tests assume that findChannel finds the first free channel available
@@ -82,14 +161,87 @@ int main()
       return 1;
     }
 
+    p->setCallbacks(printData, 0);
     p->startPhantom();
     printf("Successfully started isochronous communication with a Phantom\n");
-    // Do the isochronous iteration (should print some data on the screen atm)
+    // Do the isochronous iteration (should print some data on the screen)
     p->isoIterate();
+
+    PhantomState state;
+    if (p->getState(state) != packets_received || state.encoder[0] != last_encoder_x)
+    {
+      printf("Error: state does not contain the last received packet...\n");
+      return 1;
+    }
+
+    if (!expectIsoEnabled(p, true, "after starting"))
+      return 1;
+
+    // Pausing and resuming should keep the channels, so no new handshake with the device is needed
+    p->pausePhantom();
+    if (!p->isPaused())
+    {
+      printf("Error: device is not paused...\n");
+      return 1;
+    }
+    if (!expectIsoEnabled(p, false, "while paused"))
+      return 1;
+    p->resumePhantom();
+    if (!expectIsoEnabled(p, true, "after resuming"))
+      return 1;
+    printf("Paused and resumed isochronous communication\n");
+    p->isoIterate();
+
     p->stopPhantom();
+    if (!expectIsoEnabled(p, false, "after stopping"))
+      return 1;
     printf("Stopped isochronous communication\n");
 
+    // Receiving only should work without a transmit channel
+    p->startPhantom(Phantom::RECEIVE_ONLY);
+    p->isoIterate();
+    p->stopPhantom();
+    printf("Received without transmitting\n");
+
+    // Iterating a stopped device must not touch the deleted channels
+    bool thrown = false;
+    try
+    {
+      p->isoIterate();
+    }
+    catch (char const* str)
+    {
+      thrown = true;
+    }
+    if (!thrown)
+    {
+      printf("Error: iterating a stopped device did not throw...\n");
+      return 1;
+    }
+    p->isoTransmit();
+
     delete p;
+
+    // The enable bit is shared by both channels, it may only be cleared when the last channel stops
+    it = DeviceIterator::createInstance();
+    for (dev = it->next(); dev && !dev->isSensableDevice(); dev = it->next())
+    {
+      delete dev;
+    }
+    delete it;
+    if (dev == 0)
+    {
+      printf("Error: could not find the Phantom again...\n");
+      return 1;
+    }
+    ChannelPhantom *c = new ChannelPhantom(dev);
+    for (unsigned int order = 0; order < 4; order++)
+    {
+      if (!checkChannelOrder(c, order & 1, order & 2))
+        return 1;
+    }
+    delete c;
+    printf("Started and stopped the channels in every order\n");
   }
   catch (char const* str)
   {
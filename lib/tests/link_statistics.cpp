@@ -0,0 +1,130 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the LinkStatistics functionality
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "LinkStatistics.h"
+
+using namespace LibPhantom;
+
+static int expect(const char *name, uint64_t value, uint64_t expected)
+{
+  if (value != expected)
+  {
+    printf("Error: %s is %llu instead of %llu...\n", name, (unsigned long long) value, (unsigned long long) expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  LinkStatistics link;
+  PhantomLinkStatistics s;
+  uint32_t count0 = 0xfffffff0; // Wraps around during the test
+
+  printf("Test 1: consecutive packets\n");
+  for (int i = 0; i < 100; i++)
+  {
+    link.received(count0++, 10, 0);
+  }
+  link.get(s);
+  if (expect("packets", s.packets, 100) || expect("lost", s.lost, 0) || expect("count0", s.count0, count0 - 1))
+    return 1;
+
+  printf("Test 2: gap, duplicate and reordered packets\n");
+  count0 += 5; // 5 lost in one gap
+  link.received(count0, 10, 0);
+  link.received(count0, 10, 0); // duplicate
+  link.received(count0 + 2, 10, 0); // 1 lost...
+  link.received(count0 + 1, 10, 0); // ... but it arrives late
+  link.received(count0 + 3, 10, 2); // dropped by the driver
+  link.get(s);
+  if (expect("lost", s.lost, 6) || expect("gaps", s.gaps, 2) || expect("duplicates", s.duplicates, 1)
+      || expect("reordered", s.reordered, 1) || expect("dropped", s.dropped, 2) || expect("count0", s.count0, count0 + 3))
+    return 1;
+
+  printf("Test 3: resynchronisation\n");
+  link.received(count0 + 100000, 11, 0);
+  link.received(5, 0, 0); // device restarted
+  link.get(s);
+  if (expect("resyncs", s.resyncs, 2) || expect("restarts", s.restarts, 1) || expect("lost", s.lost, 6))
+    return 1;
+
+  printf("Test 4: rate\n");
+  for (int i = 0; i < 4 * LINK_STATISTICS_SAMPLE; i++)
+  {
+    link.received(6 + i, 0, 0);
+    usleep(100);
+  }
+  link.get(s);
+  printf("  %.0f packets per second\n", s.rate);
+  if (s.rate <= 0)
+  {
+    printf("Error: no rate...\n");
+    return 1;
+  }
+  sleep(1);
+  usleep(100000);
+  link.get(s);
+  if (s.rate != 0)
+  {
+    printf("Error: rate is %.0f while nothing is received...\n", s.rate);
+    return 1;
+  }
+
+  printf("Test 5: rate follows a change after the samples wrapped around\n");
+  uint32_t count = 6 + 4 * LINK_STATISTICS_SAMPLE;
+  for (int i = 0; i < 2 * LINK_STATISTICS_SAMPLES * LINK_STATISTICS_SAMPLE; i++)
+  {
+    link.received(count++, 0, 0);
+    usleep(100);
+  }
+  link.get(s);
+  double fast = s.rate;
+  for (int i = 0; i < 600; i++)
+  {
+    link.received(count++, 0, 0);
+    usleep(2000);
+  }
+  link.get(s);
+  printf("  %.0f packets per second, slowed down to %.0f\n", fast, s.rate);
+  if (fast <= 0 || s.rate <= 0 || s.rate > fast / 3)
+  {
+    printf("Error: rate did not follow the slower packets...\n");
+    return 1;
+  }
+
+  printf("Test 6: packets discarded on purpose are not counted\n");
+  link.get(s);
+  uint64_t lost = s.lost, resyncs = s.resyncs;
+  link.resync();
+  count += 50;
+  link.received(count++, 0, 0);
+  link.received(count++, 0, 0);
+  link.get(s);
+  if (expect("lost", s.lost, lost) || expect("resyncs", s.resyncs, resyncs) || expect("count0", s.count0, count - 1))
+    return 1;
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
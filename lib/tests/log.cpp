@@ -0,0 +1,110 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the asynchronous logging
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "Log.h"
+
+#define THREADS 4
+#define RECORDS 100
+
+using namespace LibPhantom;
+
+static void writeRecords(int thread)
+{
+  for (int i = 0; i < RECORDS; i++)
+  {
+    PHANTOM_LOG_INFO("thread %d record %d value %.1f %s", thread, i, i / 2.0, "ok");
+    // Should be removed at compile time
+    PHANTOM_LOG_TRACE("thread %d trace %d", thread, i);
+  }
+}
+
+static unsigned int countLines(FILE *f, const char *expected)
+{
+  char line[256];
+  unsigned int lines = 0;
+  bool found = false;
+
+  rewind(f);
+  while (fgets(line, sizeof(line), f))
+  {
+    lines++;
+    found |= strstr(line, expected) != 0;
+  }
+  return found ? lines : 0;
+}
+
+int main()
+{
+  FILE *f = tmpfile();
+  std::thread *threads[THREADS];
+
+  // Each thread writes into its own ring
+  for (int i = 0; i < THREADS; i++)
+  {
+    threads[i] = new std::thread(writeRecords, i);
+  }
+  for (int i = 0; i < THREADS; i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+
+  unsigned int written = Log::flush(f);
+  if (written != THREADS * RECORDS || countLines(f, "I: thread 3 record 99 value 49.5 ok") != written)
+  {
+    printf("Error: flushed %u records instead of %u...\n", written, THREADS * RECORDS);
+    return 1;
+  }
+
+  // A full ring drops records instead of blocking
+  for (int i = 0; i < PHANTOM_LOG_RING_SIZE + 10; i++)
+  {
+    PHANTOM_LOG_ERROR("overflow %d", i);
+  }
+  if (Log::getDropped() != 10)
+  {
+    printf("Error: dropped %llu records instead of 10...\n", (unsigned long long) Log::getDropped());
+    return 1;
+  }
+
+  Log::flush(f);
+
+  // The thread flushes the records, stopping it flushes the remaining ones
+  f = freopen(0, "w+", f);
+  Log::setOutput(f);
+  Log::startThread(1);
+  PHANTOM_LOG_WARNING("from the main thread");
+  Log::stopThread();
+  if (countLines(f, "W: from the main thread") != 1)
+  {
+    printf("Error: the thread did not flush the records...\n");
+    return 1;
+  }
+  Log::setOutput(0);
+  fclose(f);
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
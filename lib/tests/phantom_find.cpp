@@ -47,6 +47,7 @@ int main()
     }
     if (devices_found == 0)
       return 0; // Nothing fun to do...
+    unsigned int devices_found_total = devices_found;
 
     // and release them again
     while (devices_found > 0)
@@ -55,6 +56,43 @@ int main()
       delete list[devices_found];
     }
 
+    // Claim all PHANTOMS in one go, they should be sorted by serial
+    PhantomList phantoms = Phantom::findAll();
+    if (phantoms.size() != devices_found_total)
+    {
+      printf("Error: findAll() found %u devices instead of %u...\n", (unsigned int) phantoms.size(), devices_found_total);
+      return 1;
+    }
+    for (unsigned int j = 1; j < phantoms.size(); j++)
+    {
+      if (phantoms[j - 1]->getSerial() >= phantoms[j]->getSerial())
+      {
+        printf("Error: findAll() did not sort the devices by serial...\n");
+        return 1;
+      }
+    }
+    while (!phantoms.empty())
+    {
+      delete phantoms.back();
+      phantoms.pop_back();
+    }
+
+    // findPhantom() only claims the device with the lowest serial, the others can still be found
+    p = Phantom::findPhantom();
+    phantoms = Phantom::findAll();
+    if (phantoms.size() != devices_found_total - 1 || (!phantoms.empty() && phantoms.front()->getSerial()
+        <= p->getSerial()))
+    {
+      printf("Error: findPhantom() did not claim (only) the device with the lowest serial...\n");
+      return 1;
+    }
+    while (!phantoms.empty())
+    {
+      delete phantoms.back();
+      phantoms.pop_back();
+    }
+    delete p;
+
     // Find last PHANTOM again
     p = Phantom::findPhantom(serial);
     if (p == 0)
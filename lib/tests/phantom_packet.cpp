@@ -0,0 +1,178 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the decoding and encoding of the isochronous packets (PhantomPacket.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BatchDecoder.h"
+#include "PhantomPacket.h"
+
+using namespace LibPhantom;
+
+/**
+ * Packets in the layout of the PHANTOM Omni (little endian, constant fields as found by the reverse engineering)
+ */
+static const unsigned char packet_docked[44] = {
+    0x00, 0x00, 0x1e, 0x00, // unknown0, unknown1
+    0x34, 0x12, 0xcd, 0xab, 0x01, 0x80, // encoders: 0x1234, 0xabcd, 0x8001
+    0xe0, 0xff, 0x1f, 0x00, 0x40, 0x80, // gimbal (11 bits << 5): 0x7ff, 0x000, 0x402 (with erratic low bits)
+    0x00, 0x00, 0x00, 0x03, // unknown8, unknown9a, status: docked (bit 2 is 0)
+    0x07, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46, 0x57, 0x00, 0x00, // unknown10, gimbal_inv, unknown14/15
+    0x04, 0x03, 0x02, 0x01, // count0
+    0x00, 0x00, 0x00, 0x00, 0x06, 0x05, 0x00, 0x00 }; // unknown18/19, count1, unknown21
+
+static const unsigned char packet_buttons[44] = {
+    0x00, 0x00, 0x1e, 0x00,
+    0x00, 0x00, 0xff, 0xff, 0x10, 0x00,
+    0x1f, 0x00, 0xff, 0x7f, 0x20, 0x00,
+    0x00, 0x00, 0x00, 0x04, // both buttons pressed, not docked
+    0x07, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46, 0x57, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00 };
+
+static int check(const char *name, const PhantomState &s, const PhantomState &expected)
+{
+  if (memcmp(s.encoder, expected.encoder, sizeof(s.encoder)) || memcmp(s.gimbal, expected.gimbal, sizeof(s.gimbal))
+      || s.count0 != expected.count0 || s.count1 != expected.count1 || s.button1 != expected.button1 || s.button2
+      != expected.button2 || s.docked != expected.docked)
+  {
+    printf("Error: %s decoded as encoders %x %x %x gimbal %x %x %x count %x %x buttons %d %d docked %d\n", name,
+        s.encoder[0], s.encoder[1], s.encoder[2], s.gimbal[0], s.gimbal[1], s.gimbal[2], s.count0, s.count1, s.button1,
+        s.button2, s.docked);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  PhantomState state, expected;
+
+  printf("Test 1: docked\n");
+  decodePhantomState(packet_docked, state);
+  expected = { { 0x1234, 0xabcd, 0x8001 }, { 0x7ff, 0x000, 0x402 }, 0x01020304, 0x0506, 0, 0, 1 };
+  if (check("docked packet", state, expected))
+    return 1;
+
+  printf("Test 2: buttons pressed\n");
+  decodePhantomState(packet_buttons, state);
+  expected = { { 0x0000, 0xffff, 0x0010 }, { 0x000, 0x3ff, 0x001 }, 0xffffffff, 0xffff, 1, 1, 0 };
+  if (check("buttons packet", state, expected))
+    return 1;
+
+  printf("Test 3: encoding forces\n");
+  unsigned char packet[PhantomPacketLayout::WRITE_SIZE];
+  const uint16_t force[3] = { 0x123, 0x7ff, 0xabc };
+  memset(packet, 0xaa, sizeof(packet));
+  encodePhantomForces(packet, force, PhantomPacketLayout::STATUS_DEFAULT | PhantomPacketLayout::STATUS_MOTORS_ON);
+  const unsigned char expected_packet[] = { 0x23, 0x01, 0xff, 0x07, 0xbc, 0x0a, 0xc8, 0x53, 0, 0, 0, 0, 0, 0, 0, 0 };
+  if (memcmp(packet, expected_packet, sizeof(packet)))
+  {
+    printf("Error: forces are encoded incorrectly...\n");
+    return 1;
+  }
+
+  printf("Test 4: writing a field which is part of a word\n");
+  unsigned char status[PhantomPacketLayout::READ_SIZE];
+  memset(status, 0, sizeof(status));
+  status[18] = 0xff;
+  status[19] = 0xf7;
+  writeField(status, PhantomPacketLayout::DOCKED, 0);
+  writeField(status, PhantomPacketLayout::GIMBAL_X, 0x7ff);
+  if (status[18] != 0xff || status[19] != 0xf3 || status[10] != 0xe0 || status[11] != 0xff
+      || readField(status, PhantomPacketLayout::DOCKED) != 0 || readField(status, PhantomPacketLayout::BUTTON1) != 1)
+  {
+    printf("Error: writing a field changed the other bits of its word...\n");
+    return 1;
+  }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  printf("Test 5: comparing with the bitfields of PhantomSpec.h\n");
+  srand(1);
+  for (int i = 0; i < 100000; i++)
+  {
+    PhantomDataRead raw;
+    for (unsigned int j = 0; j < sizeof(raw); j++)
+    {
+      ((unsigned char *) &raw)[j] = rand();
+    }
+    decodePhantomState((const unsigned char *) &raw, state);
+    expected = { { raw.encoder_x, raw.encoder_y, raw.encoder_z }, { raw.gimbal.x, raw.gimbal.y, raw.gimbal.z },
+        raw.count0, (uint16_t) raw.count1, (uint8_t) !raw.status.button1, (uint8_t) !raw.status.button2,
+        (uint8_t) !raw.status.docked };
+    if (check("random packet", state, expected))
+      return 1;
+  }
+
+  PhantomDataWrite *write = (PhantomDataWrite *) packet;
+  if (write->force_x != 0x123 || write->force_z != 0xabc || !write->status.motors_on || write->status.dl_flash)
+  {
+    printf("Error: encoded forces do not match the bitfields...\n");
+    return 1;
+  }
+#endif
+
+  printf("Test 6: batch decoding\n");
+  static unsigned char packets[PHANTOM_BATCH_SIZE + 1][PhantomPacketLayout::READ_SIZE];
+  const unsigned char *pointers[PHANTOM_BATCH_SIZE + 1];
+  PhantomStateBatch batch;
+  for (unsigned int i = 0; i <= PHANTOM_BATCH_SIZE; i++)
+  {
+    for (unsigned int j = 0; j < PhantomPacketLayout::READ_SIZE; j++)
+    {
+      packets[i][j] = rand();
+    }
+    // Packets of different devices are not adjacent (nor in order)
+    pointers[i] = packets[(i * 7) % (PHANTOM_BATCH_SIZE + 1)];
+  }
+
+  for (int k = BatchDecoder::SCALAR; k <= BatchDecoder::AVX2; k++)
+  {
+    BatchDecoder::Kernel kernel = (BatchDecoder::Kernel) k;
+    if (!BatchDecoder::setKernel(kernel))
+    {
+      printf("  %s is not supported\n", BatchDecoder::getKernelName(kernel));
+      continue;
+    }
+
+    // Every number of packets, so all combinations of full SIMD blocks and remaining packets are used
+    for (unsigned int count = 0; count <= PHANTOM_BATCH_SIZE + 1; count++)
+    {
+      unsigned int decoded = BatchDecoder::decode(pointers, count, batch);
+      if (decoded != (count > PHANTOM_BATCH_SIZE ? PHANTOM_BATCH_SIZE : count) || batch.count != decoded)
+      {
+        printf("Error: %s decoded %u of %u packets...\n", BatchDecoder::getKernelName(kernel), decoded, count);
+        return 1;
+      }
+      for (unsigned int i = 0; i < decoded; i++)
+      {
+        decodePhantomState(pointers[i], expected);
+        batch.get(i, state);
+        if (check(BatchDecoder::getKernelName(kernel), state, expected))
+          return 1;
+      }
+    }
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the SampleHistory functionality
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#include "SampleHistory.h"
+
+using namespace LibPhantom;
+
+static void write(SampleHistory &history, uint32_t count0)
+{
+  PhantomState state = PhantomState();
+  state.count0 = count0;
+  state.encoder[0] = count0 & 0xffff;
+  history.write(state, count0 * 0.001);
+}
+
+int main()
+{
+  SampleHistory history(30);
+  PhantomSample sample;
+  PhantomSample window[16];
+
+  printf("Test 1: empty history\n");
+  if (history.getCapacity() != 32 || history.getCount() != 0 || history.getNewest(sample) || history.get(0, sample))
+  {
+    printf("Error: empty history has samples (or the wrong capacity)...\n");
+    return 1;
+  }
+
+  printf("Test 2: query by index\n");
+  // The message counter wraps around, and 10 packets are lost
+  uint32_t count0 = 0xffffffe0;
+  for (unsigned int i = 0; i < 100; i++)
+  {
+    if (i == 80)
+    {
+      count0 += 10;
+    }
+    write(history, count0++);
+  }
+  if (history.getCount() != 100 || !history.getNewest(sample) || sample.state.count0 != count0 - 1)
+  {
+    printf("Error: newest sample is not the last one written...\n");
+    return 1;
+  }
+  if (history.get(67, sample) || !history.get(68, sample) || sample.state.count0 != 0xffffffe0 + 68)
+  {
+    printf("Error: only the last 32 samples should be available...\n");
+    return 1;
+  }
+
+  printf("Test 3: query by cycle\n");
+  if (!history.getCycle(count0 - 5, sample) || sample.state.count0 != count0 - 5 || !history.getCycle(0xffffffe0 + 70,
+      sample) || sample.state.count0 != 0xffffffe0 + 70)
+  {
+    printf("Error: cycle not found...\n");
+    return 1;
+  }
+  if (history.getCycle(0xffffffe0 + 85, sample) || history.getCycle(0xffffffe0 + 10, sample) || history.getCycle(count0,
+      sample))
+  {
+    printf("Error: found a cycle which is lost, overwritten or not received yet...\n");
+    return 1;
+  }
+
+  printf("Test 4: query by time window\n");
+  uint32_t from = count0 - 15;
+  unsigned int n = history.getWindow(from * 0.001, (from + 4) * 0.001 + 0.0001, window, 16);
+  if (n != 5 || window[0].state.count0 != from || window[4].state.count0 != from + 4)
+  {
+    printf("Error: window has %u samples...\n", n);
+    return 1;
+  }
+  n = history.getWindow(0, 1e10, window, 16);
+  if (n != 16 || window[0].state.count0 != 0xffffffe0 + 68)
+  {
+    printf("Error: window is not limited or does not start at the oldest sample...\n");
+    return 1;
+  }
+
+  printf("Test 5: concurrent reading\n");
+  std::atomic<bool> done(false);
+  std::atomic<unsigned int> errors(0);
+  std::thread reader([&]()
+  {
+    PhantomSample s;
+    while (!done.load())
+    {
+      u_int64_t c = history.getCount();
+      for (u_int64_t i = c > 40 ? c - 40 : 0; i < c; i++)
+      {
+        if (history.get(i, s) && (s.state.encoder[0] != (s.state.count0 & 0xffff) || s.time != s.state.count0 * 0.001))
+        {
+          errors++;
+        }
+      }
+    }
+  });
+  for (unsigned int i = 0; i < 1000000; i++)
+  {
+    write(history, i);
+  }
+  done.store(true);
+  reader.join();
+  if (errors.load())
+  {
+    printf("Error: %u torn samples...\n", errors.load());
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of phantom-drivers.
+ *
+ * phantom-drivers is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * phantom-drivers is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with phantom-drivers.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test application to test the servo thread functionality
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdexcept>
+
+#include "Phantom.h"
+#include "ServoThread.h"
+
+using namespace LibPhantom;
+
+static unsigned int callbacks = 0;
+
+static void countCallback(void *userdata)
+{
+  callbacks++;
+}
+
+static void throwingCallback(void *userdata)
+{
+  throw std::runtime_error("callback failed");
+}
+
+int main()
+{
+  try
+  {
+    Phantom *p = Phantom::findPhantom();
+    if (p == 0)
+    {
+      printf("Error: could not find a Phantom...\n");
+      return 1;
+    }
+    p->startPhantom();
+
+    ServoThread servo;
+    PhantomServoStatistics s;
+
+    servo.add(p);
+    servo.setCallback(countCallback, 0);
+    servo.setRate(1000);
+    servo.setCpu(0);
+    servo.start();
+    usleep(200000);
+    servo.stop();
+    servo.getStatistics(s);
+
+    printf("%llu cycles, period %.1f us, jitter %.1f us (max %.1f us), %llu overruns\n",
+        (unsigned long long) s.cycles, s.period * 1e6, s.rmsJitter * 1e6, s.maxJitter * 1e6,
+        (unsigned long long) s.overruns);
+    printf("Real-time: %s, pinned: %s, memory locked: %s\n", s.realtime ? "yes" : "no", s.pinned ? "yes" : "no",
+        s.locked ? "yes" : "no");
+
+    if (s.cycles < 100 || s.cycles > 250 || callbacks != s.cycles)
+    {
+      printf("Error: expected about 200 cycles (with as many callbacks)...\n");
+      return 1;
+    }
+    if (s.period < 0.0009 || s.period > 0.002)
+    {
+      printf("Error: period is not about 1 ms...\n");
+      return 1;
+    }
+
+    PhantomState state;
+    if (p->getState(state) == 0)
+    {
+      printf("Error: no packets received by the servo thread...\n");
+      return 1;
+    }
+
+    printf("Test 2: exceptions stop the thread\n");
+    ServoThread failing;
+    failing.setCallback(throwingCallback, 0);
+    failing.setRate(1000);
+    failing.start();
+    usleep(50000);
+    if (failing.isRunning() || failing.getError() == 0)
+    {
+      printf("Error: thread did not stop with an error after a std::exception...\n");
+      return 1;
+    }
+    failing.stop();
+
+    p->stopPhantom();
+    delete p;
+  }
+  catch (char const* str)
+  {
+    printf("Exception raised: %s\n", str);
+    return 1;
+  }
+
+  printf("Tests succeeded!\n");
+  return 0;
+}